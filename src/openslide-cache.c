@@ -20,6 +20,8 @@
  *
  */
 
+#include <config.h>
+
 #include "openslide-private.h"
 
 #include <glib.h>
@@ -37,6 +39,7 @@ struct _openslide_cache_value {
   GList *link;            // direct pointer to the node in the list
   struct _openslide_cache_key *key; // for removing keys when aged out
   openslide_cache_t *cache; // sadly, for total_bytes and the list
+  uint64_t binding_id;  // the key may be freed first
 
   struct _openslide_cache_entry *entry;  // may outlive the value
 };
@@ -59,10 +62,21 @@ struct _openslide_cache {
 
   uint64_t capacity;
   uint64_t total_size;
+  GHashTable *binding_sizes;  // binding id -> struct binding_size
+
+  // lookup statistics
+  uint64_t hits;
+  uint64_t misses;
 
   gint warned_overlarge_entry;
 };
 
+// bytes of entries inserted by one binding
+struct binding_size {
+  uint64_t id;  // hash table key
+  uint64_t size;
+};
+
 // connection between a cache (possibly shared between multiple slide handles)
 // and a specific slide handle
 struct _openslide_cache_binding {
@@ -89,6 +103,7 @@ static void possibly_evict(openslide_cache_t *cache, uint64_t incoming_size) {
     //g_debug("EVICT: size: %d", value->entry->size);
 
     size -= value->entry->size;
+    _OPENSLIDE_PROBE(cache__evict, cache, value->entry->size);
 
     // remove from hashtable, this will trigger removal from everything
     bool result = g_hash_table_remove(cache->hashtable, key);
@@ -127,6 +142,13 @@ static void hash_destroy_value(gpointer data) {
   // decrement the total size
   g_assert(value->entry->size <= value->cache->total_size);
   value->cache->total_size -= value->entry->size;
+  struct binding_size *bs =
+    g_hash_table_lookup(value->cache->binding_sizes, &value->binding_id);
+  g_assert(bs && value->entry->size <= bs->size);
+  bs->size -= value->entry->size;
+  if (!bs->size) {
+    g_hash_table_remove(value->cache->binding_sizes, &bs->id);
+  }
 
   // unref the entry
   _openslide_cache_entry_unref(value->entry);
@@ -149,6 +171,8 @@ openslide_cache_t *_openslide_cache_create(uint64_t capacity_in_bytes) {
 					   key_equal_func,
 					   g_free,
 					   hash_destroy_value);
+  cache->binding_sizes = g_hash_table_new_full(g_int64_hash, g_int64_equal,
+                                               NULL, g_free);
 
   // init refcount
   cache->refcount = 1;
@@ -174,6 +198,7 @@ static void cache_unref(openslide_cache_t *cache) {
   }
   // clear hashtable (auto-deletes all data)
   g_hash_table_unref(cache->hashtable);
+  g_hash_table_unref(cache->binding_sizes);
   g_mutex_unlock(&cache->mutex);
 
   // clear list
@@ -196,6 +221,14 @@ void _openslide_cache_release(openslide_cache_t *cache) {
   cache_unref(cache);
 }
 
+void _openslide_cache_get_stats(openslide_cache_t *cache,
+                                uint64_t *hits, uint64_t *misses) {
+  g_mutex_lock(&cache->mutex);
+  *hits = cache->hits;
+  *misses = cache->misses;
+  g_mutex_unlock(&cache->mutex);
+}
+
 struct _openslide_cache_binding *_openslide_cache_binding_create(uint64_t capacity_in_bytes) {
   struct _openslide_cache_binding *cb =
     g_new0(struct _openslide_cache_binding, 1);
@@ -231,6 +264,26 @@ void _openslide_cache_binding_destroy(struct _openslide_cache_binding *cb) {
   g_free(cb);
 }
 
+uint64_t _openslide_cache_binding_get_size(struct _openslide_cache_binding *cb) {
+  g_mutex_lock(&cb->mutex);
+  openslide_cache_t *cache = cb->cache;
+  g_mutex_lock(&cache->mutex);
+  struct binding_size *bs = g_hash_table_lookup(cache->binding_sizes, &cb->id);
+  uint64_t size = bs ? bs->size : 0;
+  g_mutex_unlock(&cache->mutex);
+  g_mutex_unlock(&cb->mutex);
+  return size;
+}
+
+void _openslide_cache_binding_renew(struct _openslide_cache_binding *cb) {
+  g_mutex_lock(&cb->mutex);
+  openslide_cache_t *cache = cb->cache;
+  g_mutex_lock(&cache->mutex);
+  cb->id = cache->next_binding_id++;
+  g_mutex_unlock(&cache->mutex);
+  g_mutex_unlock(&cb->mutex);
+}
+
 // put and get
 
 // the cache retains one reference, and the caller gets another one.  the
@@ -242,6 +295,9 @@ void _openslide_cache_put(struct _openslide_cache_binding *cb,
 			  void *data,
 			  uint64_t size_in_bytes,
 			  struct _openslide_cache_entry **_entry) {
+  g_auto(_openslide_perf_timer) timer G_GNUC_UNUSED =
+    _openslide_perf_start(OPENSLIDE_PERF_CACHE);
+
   // always create cache entry for caller's reference
   struct _openslide_cache_entry *entry =
       g_new(struct _openslide_cache_entry, 1);
@@ -281,6 +337,7 @@ void _openslide_cache_put(struct _openslide_cache_binding *cb,
     g_new(struct _openslide_cache_value, 1);
   value->key = key;
   value->cache = cache;
+  value->binding_id = cb->id;
   value->entry = entry;
 
   // insert at head of queue
@@ -292,6 +349,13 @@ void _openslide_cache_put(struct _openslide_cache_binding *cb,
 
   // increase size
   cache->total_size += size_in_bytes;
+  struct binding_size *bs = g_hash_table_lookup(cache->binding_sizes, &cb->id);
+  if (!bs) {
+    bs = g_new0(struct binding_size, 1);
+    bs->id = cb->id;
+    g_hash_table_insert(cache->binding_sizes, &bs->id, bs);
+  }
+  bs->size += size_in_bytes;
 
   // another ref for the cache
   g_atomic_int_inc(&entry->refcount);
@@ -303,12 +367,15 @@ void _openslide_cache_put(struct _openslide_cache_binding *cb,
   //g_debug("insert %p", entry);
 }
 
-// entry must be unreffed when the caller is done with the data
-void *_openslide_cache_get(struct _openslide_cache_binding *cb,
-			   void *plane,
-			   int64_t x,
-			   int64_t y,
-			   struct _openslide_cache_entry **_entry) {
+static void *cache_get(struct _openslide_cache_binding *cb,
+                       void *plane,
+                       int64_t x,
+                       int64_t y,
+                       bool count,
+                       struct _openslide_cache_entry **_entry) {
+  g_auto(_openslide_perf_timer) timer G_GNUC_UNUSED =
+    _openslide_perf_start(OPENSLIDE_PERF_CACHE);
+
   // get cache and lock
   g_mutex_lock(&cb->mutex);
   openslide_cache_t *cache = cb->cache;
@@ -326,11 +393,19 @@ void *_openslide_cache_get(struct _openslide_cache_binding *cb,
   struct _openslide_cache_value *value = g_hash_table_lookup(cache->hashtable,
 							     &key);
   if (value == NULL) {
+    if (count) {
+      cache->misses++;
+      _OPENSLIDE_PROBE(cache__miss, cache, x, y);
+    }
     g_mutex_unlock(&cache->mutex);
     g_mutex_unlock(&cb->mutex);
     *_entry = NULL;
     return NULL;
   }
+  if (count) {
+    cache->hits++;
+    _OPENSLIDE_PROBE(cache__hit, cache, x, y);
+  }
 
   // if found, move to front of list
   GList *link = value->link;
@@ -352,6 +427,24 @@ void *_openslide_cache_get(struct _openslide_cache_binding *cb,
   return entry->data;
 }
 
+// entry must be unreffed when the caller is done with the data
+void *_openslide_cache_get(struct _openslide_cache_binding *cb,
+			   void *plane,
+			   int64_t x,
+			   int64_t y,
+			   struct _openslide_cache_entry **entry) {
+  return cache_get(cb, plane, x, y, true, entry);
+}
+
+// like _openslide_cache_get(), but not counted as a hit or miss
+void *_openslide_cache_recheck(struct _openslide_cache_binding *cb,
+                               void *plane,
+                               int64_t x,
+                               int64_t y,
+                               struct _openslide_cache_entry **entry) {
+  return cache_get(cb, plane, x, y, false, entry);
+}
+
 // value unref
 void _openslide_cache_entry_unref(struct _openslide_cache_entry *entry) {
   //g_debug("unref %p, refs %d", entry, g_atomic_int_get(&entry->refcount));
@@ -21,6 +21,8 @@
  *
  */
 
+#include <config.h>
+
 #include "openslide-private.h"
 #include "openslide-decode-gdkpixbuf.h"
 
@@ -133,6 +135,11 @@ static bool gdkpixbuf_read(const char *format,
                            uint32_t *dest,
                            int32_t w, int32_t h,
                            GError **err) {
+  g_auto(_openslide_perf_timer) timer G_GNUC_UNUSED =
+    _openslide_perf_start(OPENSLIDE_PERF_DECODE);
+  g_auto(_openslide_decode_probe) probe G_GNUC_UNUSED =
+    _openslide_decode_probe_start(format, w, h);
+
   // create loader
   g_autoptr(gdkpixbuf_ctx) ctx = gdkpixbuf_ctx_new(format, w, h, err);
   if (!ctx) {
@@ -175,6 +182,8 @@ static bool gdkpixbuf_read(const char *format,
   g_assert(ctx->pixbuf);
 
   // copy pixels
+  g_auto(_openslide_perf_timer) color_timer G_GNUC_UNUSED =
+    _openslide_perf_start(OPENSLIDE_PERF_COLOR);
   uint8_t *pixels = gdk_pixbuf_get_pixels(ctx->pixbuf);
   int rowstride = gdk_pixbuf_get_rowstride(ctx->pixbuf);
   for (int32_t y = 0; y < h; y++) {
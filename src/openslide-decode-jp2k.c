@@ -21,6 +21,8 @@
  *
  */
 
+#include <config.h>
+
 #include <string.h>
 
 #include "openslide-private.h"
@@ -61,6 +63,9 @@ static void unpack_argb(enum _openslide_jp2k_colorspace space,
                         opj_image_comp_t *comps,
                         uint32_t *dest,
                         int32_t w, int32_t h) {
+  g_auto(_openslide_perf_timer) timer G_GNUC_UNUSED =
+    _openslide_perf_start(OPENSLIDE_PERF_COLOR);
+
   int c0_sub_x = w / comps[0].w;
   int c1_sub_x = w / comps[1].w;
   int c2_sub_x = w / comps[2].w;
@@ -226,6 +231,10 @@ bool _openslide_jp2k_decode_buffer(uint32_t *dest,
                                    GError **err) {
   g_assert(data != NULL);
   g_assert(datalen >= 0);
+  g_auto(_openslide_perf_timer) timer G_GNUC_UNUSED =
+    _openslide_perf_start(OPENSLIDE_PERF_DECODE);
+  g_auto(_openslide_decode_probe) probe G_GNUC_UNUSED =
+    _openslide_decode_probe_start("jp2k", w, h);
 
   // init stream
   g_autoptr(opj_stream_t) stream = opj_stream_create(datalen, true);
@@ -21,6 +21,8 @@
  *
  */
 
+#include <config.h>
+
 #include "openslide-private.h"
 #include "openslide-decode-jpeg.h"
 
@@ -158,6 +160,11 @@ bool _openslide_jpeg_decompress_run(struct _openslide_jpeg_decompress *dc,
                                     bool grayscale,
                                     int32_t w, int32_t h,
                                     GError **err) {
+  g_auto(_openslide_perf_timer) timer G_GNUC_UNUSED =
+    _openslide_perf_start(OPENSLIDE_PERF_DECODE);
+  g_auto(_openslide_decode_probe) probe G_GNUC_UNUSED =
+    _openslide_decode_probe_start("jpeg", w, h);
+
   struct jpeg_decompress_struct *cinfo = &dc->cinfo;
 
   // set color space
@@ -221,6 +228,8 @@ bool _openslide_jpeg_decompress_run(struct _openslide_jpeg_decompress *dc,
       JDIMENSION rows_read = jpeg_read_scanlines(cinfo,
                                                  dc->rows,
                                                  cinfo->rec_outbuf_height);
+      g_auto(_openslide_perf_timer) color_timer G_GNUC_UNUSED =
+        _openslide_perf_start(OPENSLIDE_PERF_COLOR);
       int cur_row = 0;
       while (rows_read > 0) {
         // copy a row
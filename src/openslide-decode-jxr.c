@@ -80,6 +80,10 @@ static guint get_bits_per_pixel(const PKPixelFormatGUID *pixel_format) {
 
 bool _openslide_jxr_decode_buf(const void *src, int64_t src_len, uint32_t *dst,
                                int64_t dst_len, GError **err) {
+  g_auto(_openslide_perf_timer) timer G_GNUC_UNUSED =
+    _openslide_perf_start(OPENSLIDE_PERF_DECODE);
+  g_auto(_openslide_decode_probe) probe G_GNUC_UNUSED =
+    _openslide_decode_probe_start("jxr", dst_len, 1);
   struct WMPStream *pStream = NULL;
   PKImageDecode *pDecoder = NULL;
   PKFormatConverter *pConverter = NULL;
@@ -21,6 +21,8 @@
  *
  */
 
+#include <config.h>
+
 // libpng < 1.5 breaks the build if setjmp.h is included before png.h
 #include <png.h>
 
@@ -101,6 +103,11 @@ static struct png_ctx *png_ctx_new(uint32_t *dest,
 static bool png_read(png_rw_ptr read_callback, void *callback_data,
                      uint32_t *dest, int64_t w, int64_t h,
                      GError **err) {
+  g_auto(_openslide_perf_timer) timer G_GNUC_UNUSED =
+    _openslide_perf_start(OPENSLIDE_PERF_DECODE);
+  g_auto(_openslide_decode_probe) probe G_GNUC_UNUSED =
+    _openslide_decode_probe_start("png", w, h);
+
   // allocate context
   g_auto(png_ctx) ctx = png_ctx_new(dest, w, h, err);
   if (ctx == NULL) {
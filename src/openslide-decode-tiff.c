@@ -39,6 +39,8 @@
 #include "openslide-hash.h"
 
 #define HANDLE_CACHE_MAX 32
+// rough size of a libtiff handle and its parsed directory
+#define TIFF_HANDLE_SIZE (16 << 10)
 
 struct _openslide_tiffcache {
   char *filename;
@@ -87,6 +89,7 @@ bool _openslide_tiff_set_dir(TIFF *tiff,
     // avoid libtiff unnecessarily rereading directory contents
     return true;
   }
+  _OPENSLIDE_PROBE(tiff__set__directory, tiff, TIFFCurrentDirectory(tiff), dir);
   if (!TIFFSetDirectory(tiff, dir)) {  // ci-allow
     _openslide_tiff_error(err, tiff, "Cannot set TIFF directory %d", dir);
     return false;
@@ -172,6 +175,10 @@ static bool tiff_read_region(TIFF *tiff,
                              int64_t x, int64_t y,
                              int32_t w, int32_t h,
                              GError **err) {
+  g_auto(_openslide_perf_timer) timer G_GNUC_UNUSED =
+    _openslide_perf_start(OPENSLIDE_PERF_DECODE);
+  g_auto(_openslide_decode_probe) probe G_GNUC_UNUSED =
+    _openslide_decode_probe_start("tiff", w, h);
   TIFFRGBAImage img;
   char emsg[1024] = "unknown error";
   bool success = false;
@@ -194,6 +201,8 @@ static bool tiff_read_region(TIFF *tiff,
   // draw it
   if (TIFFRGBAImageGet(&img, dest, w, h)) {
     // convert ABGR -> ARGB
+    g_auto(_openslide_perf_timer) color_timer G_GNUC_UNUSED =
+      _openslide_perf_start(OPENSLIDE_PERF_COLOR);
     for (uint32_t *p = dest; p < dest + w * h; p++) {
       uint32_t val = GUINT32_SWAP_LE_BE(*p);
       *p = (val << 24) | (val >> 8);
@@ -737,6 +746,22 @@ void _openslide_cached_tiff_put(struct _openslide_cached_tiff *ct) {
   g_mutex_unlock(&tc->lock);
 }
 
+uint64_t _openslide_tiffcache_get_memory_usage(struct _openslide_tiffcache *tc) {
+  if (tc == NULL) {
+    return 0;
+  }
+  g_mutex_lock(&tc->lock);
+  uint64_t total = sizeof(*tc) + strlen(tc->filename) + 1 +
+    (g_queue_get_length(tc->cache) + tc->outstanding) *
+    (TIFF_HANDLE_SIZE + sizeof(struct tiff_file_handle));
+  // idle handles keep the strile arrays of their current directory
+  for (GList *l = tc->cache->head; l; l = l->next) {
+    total += TIFFNumberOfStrips(l->data) * 2 * sizeof(uint64_t);
+  }
+  g_mutex_unlock(&tc->lock);
+  return total;
+}
+
 void _openslide_tiffcache_destroy(struct _openslide_tiffcache *tc) {
   if (tc == NULL) {
     return;
@@ -118,6 +118,9 @@ struct _openslide_cached_tiff _openslide_tiffcache_get(struct _openslide_tiffcac
 
 void _openslide_cached_tiff_put(struct _openslide_cached_tiff *ct);
 
+// approximate
+uint64_t _openslide_tiffcache_get_memory_usage(struct _openslide_tiffcache *tc);
+
 void _openslide_tiffcache_destroy(struct _openslide_tiffcache *tc);
 
 typedef struct _openslide_tiffcache _openslide_tiffcache;
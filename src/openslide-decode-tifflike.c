@@ -34,30 +34,56 @@
 
 #define NDPI_TAG 65420
 
+// lowest-level data hashed in full for quickhash-1
+#define QUICKHASH1_MAX_DATA (5 << 20)
+// quickhash-2 input left for the properties hashed after the level
+#define QUICKHASH2_PROPERTY_RESERVE (1 << 20)
+// size of the sample hashed for quickhash-2 when the level doesn't fit
+#define QUICKHASH2_SAMPLE_DATA (16 << 20)
+
 
 struct _openslide_tifflike {
   char *filename;
   bool big_endian;
+  bool bigtiff;
   bool ndpi;
   GPtrArray *directories;
+  GMutex directory_lock;
   GMutex value_lock;
+
+  // kept from create for parsing directories, under directory_lock
+  struct _openslide_file *file;
 };
 
 struct tiff_directory {
-  GHashTable *items;
-  uint64_t offset;  // only for NDPI fixups
+  uint64_t offset;
+  uint64_t count;  // number of entries
+
+  // parsed on first use, under directory_lock
+  struct tiff_item *items;  // sorted by tag, no duplicates
+  uint64_t item_count;
+  GError *error;
 };
 
 struct tiff_item {
+  uint16_t tag;
   uint16_t type;
+  bool loaded;
   int64_t count;
-  uint64_t offset;
+  uint64_t offset;  // NO_OFFSET if the value is inline
 
-  // data format variants
+  // data format variants; small ones point into the storage below
   uint64_t *uints;
   int64_t *sints;
   double *floats;
   void *buffer;
+
+  union {
+    uint64_t uint;
+    int64_t sint;
+    double flt;
+  } small_value;
+  char small_buffer[8];
 };
 
 
@@ -177,7 +203,12 @@ static uint64_t fix_offset_ndpi(uint64_t diroff, uint64_t offset) {
   return result;
 }
 
+// single values are stored in the item
 #define ALLOC_VALUES_OR_FAIL(OUT, TYPE, COUNT) do {			\
+    if ((COUNT) == 1) {							\
+      OUT = (TYPE *) &item->small_value;				\
+      break;								\
+    }									\
     OUT = g_try_new(TYPE, COUNT);					\
     if (!OUT) {								\
       g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,		\
@@ -186,6 +217,20 @@ static uint64_t fix_offset_ndpi(uint64_t diroff, uint64_t offset) {
     }									\
   } while (0)
 
+// short strings are stored in the item
+#define ALLOC_BUFFER_OR_FAIL(OUT, LEN) do {				\
+    if ((LEN) <= (int64_t) sizeof(item->small_buffer)) {		\
+      OUT = item->small_buffer;						\
+      break;								\
+    }									\
+    OUT = g_try_malloc(LEN);						\
+    if (!OUT) {								\
+      g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,		\
+                  "Cannot allocate TIFF value array");			\
+      return false;							\
+    }									\
+  } while (0)
+
 #define CONVERT_VALUES_EXTEND(TO, FROM_TYPE, FROM, COUNT) do {		\
     const FROM_TYPE *from = (const FROM_TYPE *) FROM;			\
     for (int64_t i = 0; i < COUNT; i++) {				\
@@ -198,7 +243,8 @@ static uint64_t fix_offset_ndpi(uint64_t diroff, uint64_t offset) {
     const FROM_TYPE *from = (const FROM_TYPE *) FROM;			\
     for (int64_t i = 0; i < COUNT; i++) {				\
       if (!from[i * 2 + 1]) {						\
-        g_clear_pointer(&TO, g_free);					\
+        free_values(item, TO);						\
+        TO = NULL;							\
         g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,	\
                     "Zero denominator in rational value");		\
         return false;							\
@@ -207,6 +253,13 @@ static uint64_t fix_offset_ndpi(uint64_t diroff, uint64_t offset) {
     }									\
   } while (0)
 
+static void free_values(struct tiff_item *item, void *values) {
+  if (values != (void *) &item->small_value &&
+      values != (void *) item->small_buffer) {
+    g_free(values);
+  }
+}
+
 // value_lock must be held
 static bool set_item_values(struct tiff_item *item,
                             const void *buf,
@@ -222,7 +275,7 @@ static bool set_item_values(struct tiff_item *item,
     }
     // for TIFFTAG_XMLPACKET
     if (!item->buffer) {
-      ALLOC_VALUES_OR_FAIL(item->buffer, char, item->count + 1);
+      ALLOC_BUFFER_OR_FAIL(item->buffer, item->count + 1);
       memcpy(item->buffer, buf, item->count);
       ((char *) item->buffer)[item->count] = 0;
     }
@@ -306,7 +359,7 @@ static bool set_item_values(struct tiff_item *item,
   case TIFF_ASCII:
   case TIFF_UNDEFINED:
     if (!item->buffer) {
-      ALLOC_VALUES_OR_FAIL(item->buffer, char, item->count + 1);
+      ALLOC_BUFFER_OR_FAIL(item->buffer, item->count + 1);
       memcpy(item->buffer, buf, item->count);
       ((char *) item->buffer)[item->count] = 0;
     }
@@ -318,7 +371,7 @@ static bool set_item_values(struct tiff_item *item,
   }
 
   // record that we've set all values
-  item->offset = NO_OFFSET;
+  item->loaded = true;
   return true;
 }
 
@@ -327,7 +380,7 @@ static bool populate_item(struct _openslide_tifflike *tl,
                           GError **err) {
   g_autoptr(GMutexLocker) locker G_GNUC_UNUSED =
     g_mutex_locker_new(&tl->value_lock);
-  if (item->offset == NO_OFFSET) {
+  if (item->loaded) {
     return true;
   }
 
@@ -367,30 +420,37 @@ static bool populate_item(struct _openslide_tifflike *tl,
   return true;
 }
 
+static void tiff_items_free(struct tiff_item *items, uint64_t count) {
+  for (uint64_t n = 0; n < count; n++) {
+    struct tiff_item *item = &items[n];
+    free_values(item, item->uints);
+    free_values(item, item->sints);
+    free_values(item, item->floats);
+    free_values(item, item->buffer);
+  }
+  g_free(items);
+}
+
 static void tiff_directory_destroy(struct tiff_directory *d) {
   if (d == NULL) {
     return;
   }
-  g_hash_table_unref(d->items);
+  if (d->items) {
+    tiff_items_free(d->items, d->item_count);
+  }
+  if (d->error) {
+    g_error_free(d->error);
+  }
   g_free(d);
 }
 
 typedef struct tiff_directory tiff_directory;
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(tiff_directory, tiff_directory_destroy)
 
-static void tiff_item_destroy(gpointer data) {
-  struct tiff_item *item = data;
-
-  g_free(item->uints);
-  g_free(item->sints);
-  g_free(item->floats);
-  g_free(item->buffer);
-  g_free(item);
-}
-
+// Read the entry count and the offset of the next directory.  The entries
+// themselves are parsed by read_items() on first use.
 static struct tiff_directory *read_directory(struct _openslide_file *f,
                                              uint64_t *diroff,
-                                             struct tiff_directory *first_dir,
                                              GHashTable *loop_detector,
                                              bool bigtiff,
                                              bool ndpi,
@@ -435,18 +495,94 @@ static struct tiff_directory *read_directory(struct _openslide_file *f,
 
   //  g_debug("dircount: %"PRIu64, dircount);
 
+  // skip over the entries
+  uint64_t entry_size = bigtiff ? 20 : 12;
+  uint64_t entries_off = off + (bigtiff ? 8 : 2);
+  if (dircount > (INT64_MAX - entries_off) / entry_size) {
+    g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                "Directory count too large");
+    return NULL;
+  }
+  if (!_openslide_fseek(f, entries_off + dircount * entry_size, SEEK_SET,
+                        err)) {
+    g_prefix_error(err, "Cannot seek past directory entries: ");
+    return NULL;
+  }
 
-  // initial checks passed, initialize the directory
-  g_autoptr(tiff_directory) d = g_new0(struct tiff_directory, 1);
-  d->items = g_hash_table_new_full(g_direct_hash, g_direct_equal,
-                                   NULL, tiff_item_destroy);
+  // read the next dir offset
+  uint64_t nextdiroff = read_uint(f, (bigtiff || ndpi) ? 8 : 4,
+                                  big_endian, &ok);
+  if (!ok) {
+    g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                "Cannot read next directory offset");
+    return NULL;
+  }
+  *diroff = nextdiroff;
+
+  // success
+  struct tiff_directory *d = g_new0(struct tiff_directory, 1);
   d->offset = off;
+  d->count = dircount;
+  return d;
+}
 
-  // read all directory entries
-  for (uint64_t n = 0; n < dircount; n++) {
-    uint16_t tag = read_uint(f, 2, big_endian, &ok);
-    uint16_t type = read_uint(f, 2, big_endian, &ok);
-    uint64_t count = read_uint(f, bigtiff ? 8 : 4, big_endian, &ok);
+static struct tiff_item *find_item(struct tiff_item *items, uint64_t count,
+                                   int32_t tag) {
+  uint64_t lo = 0;
+  uint64_t hi = count;
+  while (lo < hi) {
+    uint64_t mid = lo + (hi - lo) / 2;
+    if (items[mid].tag < tag) {
+      lo = mid + 1;
+    } else if (items[mid].tag > tag) {
+      hi = mid;
+    } else {
+      return &items[mid];
+    }
+  }
+  return NULL;
+}
+
+static gint item_compare(gconstpointer a, gconstpointer b,
+                         gpointer user_data G_GNUC_UNUSED) {
+  const struct tiff_item *aa = a;
+  const struct tiff_item *bb = b;
+  return (gint) aa->tag - (gint) bb->tag;
+}
+
+// first_dir must already be parsed
+static struct tiff_item *read_items(struct _openslide_file *f,
+                                    struct tiff_directory *d,
+                                    struct tiff_directory *first_dir,
+                                    bool bigtiff,
+                                    bool ndpi,
+                                    bool big_endian,
+                                    uint64_t *item_count,
+                                    GError **err) {
+  if (!_openslide_fseek(f, d->offset + (bigtiff ? 8 : 2), SEEK_SET, err)) {
+    g_prefix_error(err, "Cannot seek to directory entries: ");
+    return NULL;
+  }
+
+  // always allocate, so an empty directory is distinguishable from an
+  // unparsed one
+  g_autofree struct tiff_item *items =
+    g_try_new0(struct tiff_item, MAX(d->count, 1));
+  if (!items) {
+    g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                "Cannot allocate TIFF directory");
+    return NULL;
+  }
+
+  // read all directory entries, keeping the raw value/offset field in
+  // small_buffer until the items are sorted
+  bool ok = true;
+  size_t field_size = bigtiff ? 8 : 4;
+  for (uint64_t n = 0; n < d->count; n++) {
+    struct tiff_item *item = &items[n];
+    item->tag = read_uint(f, 2, big_endian, &ok);
+    item->type = read_uint(f, 2, big_endian, &ok);
+    item->count = read_uint(f, bigtiff ? 8 : 4, big_endian, &ok);
 
     if (!ok) {
       g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
@@ -454,19 +590,14 @@ static struct tiff_directory *read_directory(struct _openslide_file *f,
       return NULL;
     }
 
-    //    g_debug(" tag: %d, type: %d, count: %"PRId64, tag, type, count);
-
-    // allocate the item
-    struct tiff_item *item = g_new0(struct tiff_item, 1);
-    item->type = type;
-    item->count = count;
-    g_hash_table_insert(d->items, GINT_TO_POINTER(tag), item);
+    //    g_debug(" tag: %d, type: %d, count: %"PRId64, item->tag, item->type, item->count);
 
     // compute value size
-    uint32_t value_size = get_value_size(type, &count);
+    uint64_t count = item->count;
+    uint32_t value_size = get_value_size(item->type, &count);
     if (!value_size) {
       g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
-                  "Unknown type encountered: %d", type);
+                  "Unknown type encountered: %d", item->type);
       return NULL;
     }
 
@@ -478,18 +609,40 @@ static struct tiff_directory *read_directory(struct _openslide_file *f,
     }
 
     // read in the value/offset
-    uint8_t value[bigtiff ? 8 : 4];
-    if (_openslide_fread(f, value, sizeof(value)) != sizeof(value)) {
+    if (_openslide_fread(f, item->small_buffer, field_size) != field_size) {
       g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
                   "Cannot read value/offset");
       return NULL;
     }
+  }
+
+  // sort by tag; for duplicate tags, the last one wins
+  uint64_t len = 0;
+  if (d->count) {
+    g_qsort_with_data(items, d->count, sizeof(*items), item_compare, NULL);
+    for (uint64_t n = 0; n < d->count; n++) {
+      if (n + 1 < d->count && items[n + 1].tag == items[n].tag) {
+        continue;
+      }
+      items[len++] = items[n];
+    }
+  }
+
+  // decode values, now that the items won't move
+  for (uint64_t n = 0; n < len; n++) {
+    struct tiff_item *item = &items[n];
+    uint64_t count = item->count;
+    uint32_t value_size = get_value_size(item->type, &count);
+    uint8_t value[8];
+    memcpy(value, item->small_buffer, field_size);
 
     // does value/offset contain the value?
-    if (value_size * count <= sizeof(value)) {
+    if (value_size * count <= field_size) {
       // yes
+      item->offset = NO_OFFSET;
       fix_byte_order(value, value_size, count, big_endian);
       if (!set_item_values(item, value, err)) {
+        tiff_items_free(g_steal_pointer(&items), len);
         return NULL;
       }
 
@@ -509,29 +662,20 @@ static struct tiff_directory *read_directory(struct _openslide_file *f,
         // heuristically set high-order bits of offset
         // if this tag has the same offset in the first IFD, reuse that value
         struct tiff_item *first_dir_item = NULL;
-        if (first_dir) {
-          first_dir_item = g_hash_table_lookup(first_dir->items,
-                                               GINT_TO_POINTER(tag));
+        if (first_dir && first_dir != d) {
+          g_assert(first_dir->items);
+          first_dir_item = find_item(first_dir->items, first_dir->item_count,
+                                     item->tag);
         }
         if (!first_dir_item || first_dir_item->offset != item->offset) {
-          item->offset = fix_offset_ndpi(off, item->offset);
+          item->offset = fix_offset_ndpi(d->offset, item->offset);
         }
       }
     }
   }
 
-  // read the next dir offset
-  uint64_t nextdiroff = read_uint(f, (bigtiff || ndpi) ? 8 : 4,
-                                  big_endian, &ok);
-  if (!ok) {
-    g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
-                "Cannot read next directory offset");
-    return NULL;
-  }
-  *diroff = nextdiroff;
-
-  // success
-  return g_steal_pointer(&d);
+  *item_count = len;
+  return g_steal_pointer(&items);
 }
 
 struct _openslide_tifflike *_openslide_tifflike_create(const char *filename,
@@ -596,13 +740,14 @@ struct _openslide_tifflike *_openslide_tifflike_create(const char *filename,
   g_autoptr(_openslide_tifflike) tl = g_new0(struct _openslide_tifflike, 1);
   tl->filename = g_strdup(filename);
   tl->big_endian = big_endian;
+  tl->bigtiff = bigtiff;
   tl->directories = g_ptr_array_new();
+  g_mutex_init(&tl->directory_lock);
   g_mutex_init(&tl->value_lock);
 
   // initialize directory reading
   g_autoptr(GHashTable) loop_detector =
     g_hash_table_new_full(g_int64_hash, g_int64_equal, g_free, NULL);
-  struct tiff_directory *first_dir = NULL;
 
   // NDPI needs special quirks, since it is classic TIFF pretending to be
   // BigTIFF.  Enable NDPI mode if this is classic TIFF but the offset to
@@ -610,27 +755,27 @@ struct _openslide_tifflike *_openslide_tifflike_create(const char *filename,
   // valid directory containing the NDPI_TAG.
   if (!bigtiff && diroff != 0) {
     uint64_t trial_diroff = diroff;
-    struct tiff_directory *d = read_directory(f, &trial_diroff,
-                                              NULL,
-                                              loop_detector,
-                                              bigtiff, true, big_endian,
-                                              NULL);
+    g_autoptr(tiff_directory) d = read_directory(f, &trial_diroff,
+                                                 loop_detector,
+                                                 bigtiff, true, big_endian,
+                                                 NULL);
     if (d) {
-      struct tiff_item *item =
-        g_hash_table_lookup(d->items, GINT_TO_POINTER(NDPI_TAG));
+      d->items = read_items(f, d, NULL, bigtiff, true, big_endian,
+                            &d->item_count, NULL);
+    }
+    if (d && d->items) {
+      struct tiff_item *item = find_item(d->items, d->item_count, NDPI_TAG);
       if (item && item->count) {
         // NDPI
         //g_debug("NDPI detected");
         tl->ndpi = true;
-        // save the parsed directory rather than reparsing it below
-        g_ptr_array_add(tl->directories, d);
-        first_dir = d;
+        // save the parsed directory rather than reparsing it below; later
+        // directories need its items for offset fixups
+        g_ptr_array_add(tl->directories, g_steal_pointer(&d));
         diroff = trial_diroff;
-      } else {
-        // correctly parsed the directory in NDPI mode, but didn't find
-        // NDPI_TAG
-        tiff_directory_destroy(d);
       }
+      // otherwise, correctly parsed the directory in NDPI mode, but didn't
+      // find NDPI_TAG
     }
     if (!tl->ndpi) {
       // This is classic TIFF, so diroff is 32 bits.  Mask off the high bits
@@ -641,11 +786,10 @@ struct _openslide_tifflike *_openslide_tifflike_create(const char *filename,
     }
   }
 
-  // read all the directories
+  // find all the directories; their entries are read on demand
   while (diroff != 0) {
     // read a directory
     struct tiff_directory *d = read_directory(f, &diroff,
-                                              first_dir,
                                               loop_detector,
                                               bigtiff, tl->ndpi, big_endian,
                                               err);
@@ -657,9 +801,6 @@ struct _openslide_tifflike *_openslide_tifflike_create(const char *filename,
 
     // store result
     g_ptr_array_add(tl->directories, d);
-    if (!first_dir) {
-      first_dir = d;
-    }
   }
 
   // ensure there are directories
@@ -669,6 +810,21 @@ struct _openslide_tifflike *_openslide_tifflike_create(const char *filename,
     return NULL;
   }
 
+  // every format's detection reads the first directory, so parse it now
+  // and fail here if it's malformed
+  struct tiff_directory *first = tl->directories->pdata[0];
+  if (!first->items) {
+    first->items = read_items(f, first, NULL, bigtiff, tl->ndpi, big_endian,
+                              &first->item_count, err);
+    if (!first->items) {
+      g_prefix_error(err, "Reading TIFF directory at %"PRIu64": ",
+                     first->offset);
+      return NULL;
+    }
+  }
+
+  // one handle for all the directories parsed later
+  tl->file = g_steal_pointer(&f);
   return g_steal_pointer(&tl);
 }
 
@@ -683,23 +839,61 @@ void _openslide_tifflike_destroy(struct _openslide_tifflike *tl) {
   }
   g_mutex_unlock(&tl->value_lock);
   g_ptr_array_free(tl->directories, true);
+  if (tl->file) {
+    _openslide_fclose(tl->file);
+  }
   g_free(tl->filename);
+  g_mutex_clear(&tl->directory_lock);
   g_mutex_clear(&tl->value_lock);
   g_free(tl);
 }
 
+// returns NULL and sets err if the directory couldn't be parsed
+static struct tiff_item *get_items(struct _openslide_tifflike *tl,
+                                   struct tiff_directory *d,
+                                   GError **err) {
+  struct tiff_item *items = g_atomic_pointer_get(&d->items);
+  if (items) {
+    return items;
+  }
+
+  g_autoptr(GMutexLocker) locker G_GNUC_UNUSED =
+    g_mutex_locker_new(&tl->directory_lock);
+  if (!d->items && !d->error) {
+    items = read_items(tl->file, d, tl->directories->pdata[0], tl->bigtiff,
+                       tl->ndpi, tl->big_endian, &d->item_count, &d->error);
+    if (items) {
+      g_atomic_pointer_set(&d->items, items);
+    } else {
+      g_prefix_error(&d->error, "Reading TIFF directory at %"PRIu64": ",
+                     d->offset);
+    }
+  }
+  if (d->error) {
+    g_propagate_error(err, g_error_copy(d->error));
+    return NULL;
+  }
+  return d->items;
+}
+
+// returns NULL without setting err if the tag is absent
 static struct tiff_item *get_item(struct _openslide_tifflike *tl,
-                                  int64_t dir, int32_t tag) {
+                                  int64_t dir, int32_t tag,
+                                  GError **err) {
   if (dir < 0 || dir >= tl->directories->len) {
     return NULL;
   }
   struct tiff_directory *d = tl->directories->pdata[dir];
-  return g_hash_table_lookup(d->items, GINT_TO_POINTER(tag));
+  struct tiff_item *items = get_items(tl, d, err);
+  if (!items) {
+    return NULL;
+  }
+  return find_item(items, d->item_count, tag);
 }
 
 static void print_tag(struct _openslide_tifflike *tl,
                       int64_t dir, int32_t tag) {
-  struct tiff_item *item = get_item(tl, dir, tag);
+  struct tiff_item *item = get_item(tl, dir, tag, NULL);
   g_assert(item != NULL);
 
   printf(" %d: type: %d, count: %"PRId64"\n ", tag, item->type, item->count);
@@ -768,26 +962,18 @@ static void print_tag(struct _openslide_tifflike *tl,
   printf("\n");
 }
 
-static int tag_compare(gconstpointer a, gconstpointer b) {
-  int32_t aa = GPOINTER_TO_INT(a);
-  int32_t bb = GPOINTER_TO_INT(b);
-
-  if (aa < bb) {
-    return -1;
-  } else if (aa > bb) {
-    return 1;
-  } else {
-    return 0;
-  }
-}
-
 static void print_directory(struct _openslide_tifflike *tl,
                             int64_t dir) {
+  g_autoptr(GError) tmp_err = NULL;
   struct tiff_directory *d = tl->directories->pdata[dir];
-  g_autoptr(GList) keys = g_hash_table_get_keys(d->items);
-  keys = g_list_sort(keys, tag_compare);
-  for (GList *el = keys; el; el = el->next) {
-    print_tag(tl, dir, GPOINTER_TO_INT(el->data));
+  struct tiff_item *items = get_items(tl, d, &tmp_err);
+  if (!items) {
+    printf(" %s\n\n", tmp_err->message);
+    return;
+  }
+  // already sorted by tag
+  for (uint64_t n = 0; n < d->item_count; n++) {
+    print_tag(tl, dir, items[n].tag);
   }
 
   printf("\n");
@@ -806,7 +992,16 @@ int64_t _openslide_tifflike_get_directory_count(struct _openslide_tifflike *tl)
 
 int64_t _openslide_tifflike_get_value_count(struct _openslide_tifflike *tl,
                                             int64_t dir, int32_t tag) {
-  struct tiff_item *item = get_item(tl, dir, tag);
+  GError *tmp_err = NULL;
+  struct tiff_item *item = get_item(tl, dir, tag, &tmp_err);
+  if (tmp_err) {
+    // a malformed directory has no values
+    if (_openslide_debug(OPENSLIDE_DEBUG_DETECTION)) {
+      g_message("tifflike: %s", tmp_err->message);
+    }
+    g_error_free(tmp_err);
+    return 0;
+  }
   if (item == NULL) {
     return 0;
   }
@@ -816,7 +1011,12 @@ int64_t _openslide_tifflike_get_value_count(struct _openslide_tifflike *tl,
 static struct tiff_item *get_and_check_item(struct _openslide_tifflike *tl,
                                             int64_t dir, int32_t tag,
                                             GError **err) {
-  struct tiff_item *item = get_item(tl, dir, tag);
+  GError *tmp_err = NULL;
+  struct tiff_item *item = get_item(tl, dir, tag, &tmp_err);
+  if (tmp_err) {
+    g_propagate_error(err, tmp_err);
+    return NULL;
+  }
   if (item == NULL || item->count == 0) {
     g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_NO_VALUE,
                 "No such value: directory %"PRId64", tag %d", dir, tag);
@@ -1101,22 +1301,55 @@ static bool hash_tiff_level(struct _openslide_hash *hash,
   }
 
   // check total size
-  int64_t total = 0;
+  uint64_t total = 0;
   for (int64_t i = 0; i < count; i++) {
     total += lengths[i];
-    if (total > (5 << 20)) {
-      // This is a non-pyramidal image or one with a very large top level.
-      // Refuse to calculate a quickhash for it to keep openslide_open()
-      // from taking an arbitrary amount of time.  (#79)
-      _openslide_hash_disable(hash);
-      return true;
-    }
+  }
+  if (total > QUICKHASH1_MAX_DATA) {
+    // This is a non-pyramidal image or one with a very large top level.
+    // Refuse to calculate quickhash-1 for it, since hashing it would make
+    // openslide_open() take an arbitrary amount of time.  (#79)
+    _openslide_hash_disable_quickhash1(hash);
+  }
+  // hash every tile/strip if quickhash-2 can take them all, otherwise
+  // every stride'th one up to a fixed budget
+  int64_t stride = 1;
+  uint64_t budget = total;
+  if (total > QUICKHASH1_MAX_DATA &&
+      total + QUICKHASH2_PROPERTY_RESERVE >
+      _openslide_hash_get_quickhash2_remaining(hash)) {
+    stride = (total + QUICKHASH2_SAMPLE_DATA - 1) / QUICKHASH2_SAMPLE_DATA;
+    budget = QUICKHASH2_SAMPLE_DATA;
+    // the sample doesn't cover the whole level, so at least tell apart
+    // levels of different sizes.  quickhash-1 is already disabled.
+    uint64_t sampling[] = {GUINT64_TO_LE(stride), GUINT64_TO_LE(total)};
+    _openslide_hash_data(hash, sampling, sizeof(sampling));
   }
 
-  // hash raw data of each tile/strip
-  for (int64_t i = 0; i < count; i++) {
-    if (!_openslide_hash_file_part(hash, tl->filename, offsets[i], lengths[i],
-                                   err)) {
+  g_autoptr(_openslide_file) f = _openslide_fopen(tl->filename, err);
+  if (!f) {
+    return false;
+  }
+
+  // hash raw data of each selected tile/strip in order, reading each run
+  // of adjacent tiles/strips at once
+  uint64_t hashed = 0;
+  for (int64_t i = 0; i < count;) {
+    uint64_t start = offsets[i];
+    uint64_t end = start + lengths[i];
+    if (hashed + lengths[i] > budget) {
+      break;
+    }
+    hashed += lengths[i];
+    for (i += stride;
+         stride == 1 && i < count && offsets[i] == end &&
+         hashed + lengths[i] <= budget;
+         i++) {
+      end += lengths[i];
+      hashed += lengths[i];
+    }
+    if (!_openslide_hash_file_range(hash, f, start, end - start, err)) {
+      g_prefix_error(err, "Can't read from %s: ", tl->filename);
       return false;
     }
   }
@@ -31,6 +31,7 @@
 #include <libxml/tree.h>
 #include <libxml/xpath.h>
 #include <libxml/xpathInternals.h>
+#include <libxml/xmlreader.h>
 
 xmlDoc *_openslide_xml_parse(const char *xml, GError **err) {
   xmlDoc *doc = xmlReadMemory(xml, strlen(xml), "/", NULL,
@@ -45,13 +46,64 @@ xmlDoc *_openslide_xml_parse(const char *xml, GError **err) {
   return doc;
 }
 
-bool _openslide_xml_has_default_namespace(xmlDoc *doc, const char *ns) {
-  xmlNode *root = xmlDocGetRootElement(doc);
-  if (ns && root->ns) {
-    return !xmlStrcmp(root->ns->href, BAD_CAST ns);
+xmlTextReader *_openslide_xml_reader_create(const char *xml, GError **err) {
+  xmlTextReader *reader = xmlReaderForMemory(xml, strlen(xml), "/", NULL,
+                                             XML_PARSE_NOERROR |
+                                             XML_PARSE_NOWARNING |
+                                             XML_PARSE_NONET);
+  if (reader == NULL) {
+    g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                "Could not create XML reader");
+    return NULL;
+  }
+  return reader;
+}
+
+// advance to the next start tag at depth <= max_depth (the root is depth 0),
+// skipping text and the contents of any element deeper than that without
+// building a tree.  Return the depth of the element, or -1 at end of
+// document or on error (with err set).
+int _openslide_xml_reader_next_element(xmlTextReader *reader, int max_depth,
+                                       GError **err) {
+  int ret;
+  if (xmlTextReaderNodeType(reader) == XML_READER_TYPE_ELEMENT &&
+      xmlTextReaderDepth(reader) >= max_depth) {
+    // don't descend into the current element
+    ret = xmlTextReaderNext(reader);
   } else {
-    return (!ns && !root->ns);
+    ret = xmlTextReaderRead(reader);
+  }
+  while (ret == 1) {
+    if (xmlTextReaderNodeType(reader) == XML_READER_TYPE_ELEMENT) {
+      int depth = xmlTextReaderDepth(reader);
+      if (depth <= max_depth) {
+        return depth;
+      }
+      ret = xmlTextReaderNext(reader);
+    } else {
+      ret = xmlTextReaderRead(reader);
+    }
+  }
+  if (ret < 0) {
+    g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                "Could not parse XML");
+  }
+  return -1;
+}
+
+// read the rest of the document without building a tree, failing if it
+// isn't well-formed
+bool _openslide_xml_reader_check_rest(xmlTextReader *reader, GError **err) {
+  int ret;
+  do {
+    ret = xmlTextReaderNext(reader);
+  } while (ret == 1);
+  if (ret < 0) {
+    g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                "Could not parse XML");
+    return false;
   }
+  return true;
 }
 
 int64_t _openslide_xml_parse_int_attr(xmlNode *node, const char *name,
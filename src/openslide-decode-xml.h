@@ -28,16 +28,24 @@
 #include <glib.h>
 #include <libxml/tree.h>
 #include <libxml/xpath.h>
+#include <libxml/xmlreader.h>
 
 /* libxml support code */
 
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(xmlDoc, xmlFreeDoc)
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(xmlXPathContext, xmlXPathFreeContext)
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(xmlXPathObject, xmlXPathFreeObject)
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(xmlTextReader, xmlFreeTextReader)
 
 xmlDoc *_openslide_xml_parse(const char *xml, GError **err);
 
-bool _openslide_xml_has_default_namespace(xmlDoc *doc, const char *ns);
+/* streaming reader, for large documents we don't need as a tree */
+xmlTextReader *_openslide_xml_reader_create(const char *xml, GError **err);
+
+int _openslide_xml_reader_next_element(xmlTextReader *reader, int max_depth,
+                                       GError **err);
+
+bool _openslide_xml_reader_check_rest(xmlTextReader *reader, GError **err);
 
 int64_t _openslide_xml_parse_int_attr(xmlNode *node, const char *name,
                                       GError **err);
@@ -122,7 +122,15 @@ struct _openslide_file *_openslide_fopen(const char *path, GError **err)
   return file;
 }
 
+// for diagnostic output such as traces
+FILE *_openslide_fopen_output(const char *path, GError **err) {
+  return do_fopen(path, "w" FOPEN_CLOEXEC_FLAG, err);
+}
+
 size_t _openslide_fread(struct _openslide_file *file, void *buf, size_t size) {
+  g_auto(_openslide_perf_timer) timer G_GNUC_UNUSED =
+    _openslide_perf_start(OPENSLIDE_PERF_IO);
+  _OPENSLIDE_PROBE(file__read, file, -1, size);
   char *bufp = buf;
   size_t total = 0;
   while (total < size) {
@@ -135,6 +143,48 @@ size_t _openslide_fread(struct _openslide_file *file, void *buf, size_t size) {
   return total;
 }
 
+bool _openslide_fread_at(struct _openslide_file *file, off_t offset,
+                         void *buf, size_t size, GError **err) {
+  g_auto(_openslide_perf_timer) timer G_GNUC_UNUSED =
+    _openslide_perf_start(OPENSLIDE_PERF_IO);
+  _OPENSLIDE_PROBE(file__read, file, (int64_t) offset, size);
+#ifdef _WIN32
+  // no pread(); this moves the file position
+  if (!_openslide_fseek(file, offset, SEEK_SET, err)) {
+    return false;
+  }
+  if (_openslide_fread(file, buf, size) != size) {
+    g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                "Short read at offset %"PRId64, (int64_t) offset);
+    return false;
+  }
+  return true;
+#else
+  int fd = fileno(file->fp);
+  char *bufp = buf;
+  size_t total = 0;
+  while (total < size) {
+    ssize_t count = pread(fd, bufp + total, size - total,  // ci-allow
+                          offset + total);
+    if (count == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      io_error(err, "Couldn't read at offset %"PRId64,
+               (int64_t) (offset + total));
+      return false;
+    }
+    if (count == 0) {
+      g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                  "Short read at offset %"PRId64, (int64_t) offset);
+      return false;
+    }
+    total += count;
+  }
+  return true;
+#endif
+}
+
 bool _openslide_fseek(struct _openslide_file *file, off_t offset, int whence,
                       GError **err) {
   if (fseeko(file->fp, offset, whence)) {  // ci-allow
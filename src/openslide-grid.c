@@ -61,6 +61,8 @@ struct grid_ops {
                        struct _openslide_level *level,
                        int32_t w, int32_t h,
                        GError **err);
+  uint64_t (*get_memory_usage)(struct _openslide_grid *grid,
+                               uint64_t tile_data_size);
   void (*destroy)(struct _openslide_grid *grid);
 };
 
@@ -365,6 +367,11 @@ static bool simple_paint_region(struct _openslide_grid *_grid,
   return read_tiles(cr, level, _grid, &region, simple_read_tile, arg, err);
 }
 
+static uint64_t simple_get_memory_usage(struct _openslide_grid *_grid G_GNUC_UNUSED,
+                                        uint64_t tile_data_size G_GNUC_UNUSED) {
+  return sizeof(struct simple_grid);
+}
+
 static void simple_destroy(struct _openslide_grid *_grid) {
   struct simple_grid *grid = (struct simple_grid *) _grid;
 
@@ -374,6 +381,7 @@ static void simple_destroy(struct _openslide_grid *_grid) {
 static const struct grid_ops simple_grid_ops = {
   .get_bounds = simple_get_bounds,
   .paint_region = simple_paint_region,
+  .get_memory_usage = simple_get_memory_usage,
   .destroy = simple_destroy,
 };
 
@@ -511,6 +519,15 @@ static bool tilemap_paint_region(struct _openslide_grid *_grid,
   return read_tiles(cr, level, _grid, &region, tilemap_read_tile, arg, err);
 }
 
+static uint64_t tilemap_get_memory_usage(struct _openslide_grid *_grid,
+                                         uint64_t tile_data_size) {
+  struct tilemap_grid *grid = (struct tilemap_grid *) _grid;
+
+  return sizeof(*grid) + _openslide_hash_table_overhead(grid->tiles) +
+         g_hash_table_size(grid->tiles) *
+         (sizeof(struct tilemap_tile) + tile_data_size);
+}
+
 static void tilemap_destroy(struct _openslide_grid *_grid) {
   struct tilemap_grid *grid = (struct tilemap_grid *) _grid;
 
@@ -521,6 +538,7 @@ static void tilemap_destroy(struct _openslide_grid *_grid) {
 static const struct grid_ops tilemap_grid_ops = {
   .get_bounds = tilemap_get_bounds,
   .paint_region = tilemap_paint_region,
+  .get_memory_usage = tilemap_get_memory_usage,
   .destroy = tilemap_destroy,
 };
 
@@ -748,6 +766,34 @@ static bool range_paint_region(struct _openslide_grid *_grid,
   return true;
 }
 
+static uint64_t range_get_memory_usage(struct _openslide_grid *_grid,
+                                       uint64_t tile_data_size) {
+  struct range_grid *grid = (struct range_grid *) _grid;
+
+  uint64_t total = sizeof(*grid) +
+    grid->tiles->len * (sizeof(void *) + sizeof(struct range_tile) +
+                        tile_data_size);
+  GHashTable *bins = grid->bins_runtime ? grid->bins_runtime : grid->bins_init;
+  total += _openslide_hash_table_overhead(bins);
+  GHashTableIter iter;
+  void *value;
+  g_hash_table_iter_init(&iter, bins);
+  while (g_hash_table_iter_next(&iter, NULL, &value)) {
+    uint64_t count = 0;
+    if (grid->bins_runtime) {
+      // NULL-terminated
+      for (struct range_tile **tile = value; *tile; tile++) {
+        count++;
+      }
+      count++;
+    } else {
+      count = ((GPtrArray *) value)->len;
+    }
+    total += sizeof(struct range_bin_address) + count * sizeof(void *);
+  }
+  return total;
+}
+
 static void range_destroy(struct _openslide_grid *_grid) {
   struct range_grid *grid = (struct range_grid *) _grid;
 
@@ -771,6 +817,7 @@ static void range_destroy(struct _openslide_grid *_grid) {
 static const struct grid_ops range_grid_ops = {
   .get_bounds = range_get_bounds,
   .paint_region = range_paint_region,
+  .get_memory_usage = range_get_memory_usage,
   .destroy = range_destroy,
 };
 
@@ -904,6 +951,14 @@ bool _openslide_grid_paint_region(struct _openslide_grid *grid,
   return grid->ops->paint_region(grid, cr, arg, x, y, level, w, h, err);
 }
 
+uint64_t _openslide_grid_get_memory_usage(struct _openslide_grid *grid,
+                                          uint64_t tile_data_size) {
+  if (grid == NULL) {
+    return 0;
+  }
+  return grid->ops->get_memory_usage(grid, tile_data_size);
+}
+
 void _openslide_grid_destroy(struct _openslide_grid *grid) {
   if (grid == NULL) {
     return;
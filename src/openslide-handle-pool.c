@@ -0,0 +1,127 @@
+/*
+ *  OpenSlide, a library for reading whole slide image files
+ *
+ *  Copyright (c) 2026 OpenSlide contributors
+ *  All rights reserved.
+ *
+ *  OpenSlide is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation, version 2.1.
+ *
+ *  OpenSlide is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with OpenSlide. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Handle pool, limiting the number of slide handles with an open backend.
+ *
+ * Handles with an open backend are kept in LRU order.  Whenever a handle
+ * is used and the pool is over its limit, the least recently used idle
+ * handles are parked: their backend is closed and reopened on their next
+ * read.  A handle is idle if nobody holds its backend lock.
+ */
+
+#include "openslide-private.h"
+
+#include <glib.h>
+
+struct _openslide_handle_pool {
+  GMutex mutex;
+  GQueue lru;  // handles with open backends, most recently used first
+  int32_t max_open;
+
+  int refcount;
+  bool released;
+};
+
+openslide_handle_pool_t *_openslide_handle_pool_create(int32_t max_open) {
+  openslide_handle_pool_t *pool = g_new0(openslide_handle_pool_t, 1);
+  g_mutex_init(&pool->mutex);
+  g_queue_init(&pool->lru);
+  pool->max_open = max_open;
+  pool->refcount = 1;
+  return pool;
+}
+
+void _openslide_handle_pool_ref(openslide_handle_pool_t *pool) {
+  g_mutex_lock(&pool->mutex);
+  pool->refcount++;
+  g_mutex_unlock(&pool->mutex);
+}
+
+void _openslide_handle_pool_unref(openslide_handle_pool_t *pool) {
+  g_mutex_lock(&pool->mutex);
+  // decrement refcount, return if references remain
+  if (--pool->refcount) {
+    g_mutex_unlock(&pool->mutex);
+    return;
+  }
+  g_assert(g_queue_is_empty(&pool->lru));
+  g_mutex_unlock(&pool->mutex);
+
+  g_mutex_clear(&pool->mutex);
+  g_free(pool);
+}
+
+void _openslide_handle_pool_release(openslide_handle_pool_t *pool) {
+  g_mutex_lock(&pool->mutex);
+  bool already_released = pool->released;
+  pool->released = true;
+  g_mutex_unlock(&pool->mutex);
+  g_return_if_fail(!already_released);
+
+  _openslide_handle_pool_unref(pool);
+}
+
+void _openslide_handle_pool_touch(openslide_handle_pool_t *pool,
+                                  openslide_t *osr) {
+  g_autoptr(GPtrArray) victims = g_ptr_array_new();
+
+  g_mutex_lock(&pool->mutex);
+  // move to the front
+  if (osr->pool_link.data) {
+    g_queue_unlink(&pool->lru, &osr->pool_link);
+  }
+  osr->pool_link.data = osr;
+  g_queue_push_head_link(&pool->lru, &osr->pool_link);
+
+  // pick idle victims, oldest first.  The trylock can't deadlock against
+  // a thread that holds a backend lock and wants our mutex.
+  GList *link = pool->lru.tail;
+  while (link && pool->lru.length > (guint) pool->max_open) {
+    GList *prev = link->prev;
+    openslide_t *victim = link->data;
+    if (victim != osr &&
+        g_rw_lock_writer_trylock(&victim->backend_lock)) {
+      g_queue_unlink(&pool->lru, link);
+      link->data = NULL;
+      g_ptr_array_add(victims, victim);
+    }
+    link = prev;
+  }
+  g_mutex_unlock(&pool->mutex);
+
+  // close their backends without holding the mutex
+  for (guint i = 0; i < victims->len; i++) {
+    openslide_t *victim = victims->pdata[i];
+    _openslide_park_backend(victim);
+    g_rw_lock_writer_unlock(&victim->backend_lock);
+  }
+}
+
+void _openslide_handle_pool_remove(openslide_handle_pool_t *pool,
+                                   openslide_t *osr) {
+  g_mutex_lock(&pool->mutex);
+  if (osr->pool_link.data) {
+    g_queue_unlink(&pool->lru, &osr->pool_link);
+    osr->pool_link.data = NULL;
+  }
+  g_mutex_unlock(&pool->mutex);
+}
@@ -27,24 +27,156 @@
 #include <string.h>
 #include <glib.h>
 
+// largest single read when hashing file contents
+#define READ_CHUNK_SIZE (4 << 20)
+
+// quickhash-2 leaf size and digest length
+#define LEAF_SIZE (1 << 20)
+#define DIGEST_LEN 32
+
+// quickhash-2 is disabled if its input would exceed this, so that no
+// backend can make openslide_open() hash an unbounded amount of data
+#define TREE_MAX_INPUT (64 << 20)
+
+/*
+ * quickhash-2 is a two-level tree hash of the same input stream as
+ * quickhash-1: the SHA-256 of the concatenated SHA-256 digests of each
+ * consecutive 1 MiB leaf of the input, followed by the input length in
+ * bytes as a little-endian uint64.  Once there is more than one leaf,
+ * leaves are hashed in parallel.
+ */
+
+struct leaf {
+  struct _openslide_hash *hash;
+  uint8_t *data;
+  size_t len;
+  uint8_t digest[DIGEST_LEN];
+};
+
 struct _openslide_hash {
+  // quickhash-1
   GChecksum *checksum;
   bool enabled;
+
+  // quickhash-2
+  bool tree_enabled;
+  uint64_t tree_len;
+  uint8_t *chunk;  // current partial leaf
+  size_t chunk_len;
+  GPtrArray *leaves;  // struct leaf, in input order
+  GThreadPool *pool;
+  GMutex lock;
+  GCond cond;
+  int pending;  // leaves not yet hashed
+  char *tree_string;
 };
 
+static void leaf_free(struct leaf *leaf) {
+  g_free(leaf->data);
+  g_free(leaf);
+}
+
 struct _openslide_hash *_openslide_hash_quickhash1_create(void) {
-  struct _openslide_hash *hash = g_new(struct _openslide_hash, 1);
+  struct _openslide_hash *hash = g_new0(struct _openslide_hash, 1);
   hash->checksum = g_checksum_new(G_CHECKSUM_SHA256);
   hash->enabled = true;
+  hash->tree_enabled = true;
+  hash->leaves = g_ptr_array_new_with_free_func((GDestroyNotify) leaf_free);
+  g_mutex_init(&hash->lock);
+  g_cond_init(&hash->cond);
 
   return hash;
 }
 
+static void digest_leaf(struct leaf *leaf) {
+  g_autoptr(GChecksum) checksum = g_checksum_new(G_CHECKSUM_SHA256);
+  g_checksum_update(checksum, leaf->data, leaf->len);
+  gsize len = sizeof(leaf->digest);
+  g_checksum_get_digest(checksum, leaf->digest, &len);
+  g_clear_pointer(&leaf->data, g_free);
+}
+
+static void hash_leaf(void *data, void *user_data G_GNUC_UNUSED) {
+  struct leaf *leaf = data;
+  digest_leaf(leaf);
+
+  struct _openslide_hash *hash = leaf->hash;
+  g_mutex_lock(&hash->lock);
+  hash->pending--;
+  g_cond_broadcast(&hash->cond);
+  g_mutex_unlock(&hash->lock);
+}
+
+static void wait_for_leaves(struct _openslide_hash *hash, int max_pending) {
+  g_mutex_lock(&hash->lock);
+  while (hash->pending > max_pending) {
+    g_cond_wait(&hash->cond, &hash->lock);
+  }
+  g_mutex_unlock(&hash->lock);
+}
+
+static void push_leaf(struct _openslide_hash *hash, struct leaf *leaf) {
+  g_mutex_lock(&hash->lock);
+  hash->pending++;
+  g_mutex_unlock(&hash->lock);
+  g_thread_pool_push(hash->pool, leaf, NULL);
+}
+
+static void submit_leaf(struct _openslide_hash *hash) {
+  struct leaf *leaf = g_new0(struct leaf, 1);
+  leaf->hash = hash;
+  leaf->data = g_steal_pointer(&hash->chunk);
+  leaf->len = hash->chunk_len;
+  hash->chunk_len = 0;
+  g_ptr_array_add(hash->leaves, leaf);
+  if (hash->leaves->len == 1) {
+    // hashed inline if it turns out to be the only leaf
+    return;
+  }
+
+  int threads = g_get_num_processors();
+  if (!hash->pool) {
+    hash->pool = g_thread_pool_new(hash_leaf, NULL, threads, false, NULL);
+    push_leaf(hash, hash->leaves->pdata[0]);
+  }
+  // bound the memory held by queued leaves
+  wait_for_leaves(hash, 2 * threads - 1);
+  push_leaf(hash, leaf);
+}
+
+static void update_tree(struct _openslide_hash *hash, const uint8_t *data,
+                        size_t len) {
+  if (hash->tree_len + len > TREE_MAX_INPUT) {
+    hash->tree_enabled = false;
+    return;
+  }
+  hash->tree_len += len;
+  while (len) {
+    if (!hash->chunk) {
+      hash->chunk = g_malloc(LEAF_SIZE);
+    }
+    size_t count = MIN(len, LEAF_SIZE - hash->chunk_len);
+    memcpy(hash->chunk + hash->chunk_len, data, count);
+    hash->chunk_len += count;
+    data += count;
+    len -= count;
+    if (hash->chunk_len == LEAF_SIZE) {
+      submit_leaf(hash);
+    }
+  }
+}
+
 void _openslide_hash_data(struct _openslide_hash *hash, const void *data,
                           int32_t datalen) {
-  if (hash && hash->enabled && data && datalen) {
+  if (!hash || !data || !datalen) {
+    return;
+  }
+  if (hash->enabled) {
     g_checksum_update(hash->checksum, data, datalen);
   }
+  if (hash->tree_enabled) {
+    update_tree(hash, data, datalen);
+  }
 }
 
 void _openslide_hash_string(struct _openslide_hash *hash, const char *str) {
@@ -76,52 +208,104 @@ bool _openslide_hash_file_part(struct _openslide_hash *hash,
     size = len - offset;
   }
 
-  uint8_t buf[4096];
-
-  if (offset != 0) {
-    if (!_openslide_fseek(f, offset, SEEK_SET, err)) {
-      g_prefix_error(err, "Can't seek in %s: ", filename);
-      return false;
-    }
+  if (!_openslide_hash_file_range(hash, f, offset, size, err)) {
+    g_prefix_error(err, "Can't read from %s: ", filename);
+    return false;
   }
+  return true;
+}
 
-  int64_t bytes_left = size;
-  while (bytes_left > 0) {
-    int64_t bytes_to_read = MIN((int64_t) sizeof buf, bytes_left);
-    int64_t bytes_read = _openslide_fread(f, buf, bytes_to_read);
-
-    if (bytes_read != bytes_to_read) {
-      g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
-                  "Can't read from %s", filename);
+// doesn't use or move the file position, so the caller can hash many
+// ranges from one open file
+bool _openslide_hash_file_range(struct _openslide_hash *hash,
+                                struct _openslide_file *f,
+                                int64_t offset, int64_t size,
+                                GError **err) {
+  if (size <= 0 || !hash || (!hash->enabled && !hash->tree_enabled)) {
+    return true;
+  }
+  g_autofree uint8_t *buf = g_malloc(MIN(size, READ_CHUNK_SIZE));
+  while (size > 0) {
+    int64_t count = MIN(size, READ_CHUNK_SIZE);
+    if (!_openslide_fread_at(f, offset, buf, count, err)) {
       return false;
     }
-
-    //    g_debug("hash '%s' %"PRId64" %d", filename, offset + (size - bytes_left), bytes_to_read);
-
-    bytes_left -= bytes_read;
-
-    _openslide_hash_data(hash, buf, bytes_read);
+    _openslide_hash_data(hash, buf, count);
+    offset += count;
+    size -= count;
   }
-
   return true;
 }
 
 // Invalidate this hash.  Use if this slide is unhashable for some reason.
 void _openslide_hash_disable(struct _openslide_hash *hash) {
+  if (hash) {
+    hash->enabled = false;
+    hash->tree_enabled = false;
+  }
+}
+
+// Invalidate only quickhash-1, e.g. because the hashed data would exceed
+// its size limit.  quickhash-2 has a larger limit.
+void _openslide_hash_disable_quickhash1(struct _openslide_hash *hash) {
   if (hash) {
     hash->enabled = false;
   }
 }
 
 const char *_openslide_hash_get_string(struct _openslide_hash *hash) {
-  if (hash->enabled) {
+  if (hash && hash->enabled) {
     return g_checksum_get_string(hash->checksum);
   } else {
     return NULL;
   }
 }
 
+// how much more input quickhash-2 accepts before it is disabled
+uint64_t _openslide_hash_get_quickhash2_remaining(struct _openslide_hash *hash) {
+  if (!hash || !hash->tree_enabled) {
+    return 0;
+  }
+  return TREE_MAX_INPUT - hash->tree_len;
+}
+
+// no more data can be hashed afterward
+const char *_openslide_hash_get_quickhash2_string(struct _openslide_hash *hash) {
+  if (!hash || !hash->tree_enabled) {
+    return NULL;
+  }
+  if (!hash->tree_string) {
+    if (hash->chunk_len) {
+      submit_leaf(hash);
+    }
+    if (hash->pool) {
+      wait_for_leaves(hash, 0);
+    } else if (hash->leaves->len) {
+      digest_leaf(hash->leaves->pdata[0]);
+    }
+
+    g_autoptr(GChecksum) root = g_checksum_new(G_CHECKSUM_SHA256);
+    for (guint i = 0; i < hash->leaves->len; i++) {
+      struct leaf *leaf = hash->leaves->pdata[i];
+      g_checksum_update(root, leaf->digest, sizeof(leaf->digest));
+    }
+    uint64_t len = GUINT64_TO_LE(hash->tree_len);
+    g_checksum_update(root, (const guchar *) &len, sizeof(len));
+    hash->tree_string = g_strdup(g_checksum_get_string(root));
+  }
+  return hash->tree_string;
+}
+
 void _openslide_hash_destroy(struct _openslide_hash *hash) {
+  wait_for_leaves(hash, 0);
+  if (hash->pool) {
+    g_thread_pool_free(hash->pool, false, true);
+  }
+  g_ptr_array_unref(hash->leaves);
+  g_free(hash->chunk);
+  g_free(hash->tree_string);
+  g_mutex_clear(&hash->lock);
+  g_cond_clear(&hash->cond);
   g_checksum_free(hash->checksum);
   g_free(hash);
 }
@@ -30,6 +30,7 @@
 #include <glib.h>
 
 struct _openslide_hash;
+struct _openslide_file;
 
 // constructor
 struct _openslide_hash *_openslide_hash_quickhash1_create(void);
@@ -44,12 +45,19 @@ bool _openslide_hash_file_part(struct _openslide_hash *hash,
 			       const char *filename,
 			       int64_t offset, int64_t size,
 			       GError **err);
+bool _openslide_hash_file_range(struct _openslide_hash *hash,
+                                struct _openslide_file *f,
+                                int64_t offset, int64_t size,
+                                GError **err);
 
 // lockout
 void _openslide_hash_disable(struct _openslide_hash *hash);
+void _openslide_hash_disable_quickhash1(struct _openslide_hash *hash);
 
-// accessor
+// accessors
 const char *_openslide_hash_get_string(struct _openslide_hash *hash);
+const char *_openslide_hash_get_quickhash2_string(struct _openslide_hash *hash);
+uint64_t _openslide_hash_get_quickhash2_remaining(struct _openslide_hash *hash);
 
 // destructor
 void _openslide_hash_destroy(struct _openslide_hash *hash);
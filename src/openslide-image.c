@@ -1,8 +1,11 @@
 #include <config.h>
+#include "openslide-private.h"
 #include "openslide-image.h"
 
 
 void _openslide_bgr24_to_argb32(uint8_t *src, size_t src_len, uint32_t *dst) {
+  g_auto(_openslide_perf_timer) timer G_GNUC_UNUSED =
+    _openslide_perf_start(OPENSLIDE_PERF_COLOR);
   // one 24-bit pixel at a time
   for (size_t i = 0; i < src_len; i += 3, src += 3) {
     *dst++ = (0xFF000000 |
@@ -13,6 +16,8 @@ void _openslide_bgr24_to_argb32(uint8_t *src, size_t src_len, uint32_t *dst) {
 }
 
 void _openslide_bgr48_to_argb32(uint8_t *src, size_t src_len, uint32_t *dst) {
+  g_auto(_openslide_perf_timer) timer G_GNUC_UNUSED =
+    _openslide_perf_start(OPENSLIDE_PERF_COLOR);
   // one 48-bit pixel at a time
   for (size_t i = 0; i < src_len; i += 6, src += 6) {
     *dst++ = (0xFF000000 |
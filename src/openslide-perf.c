@@ -0,0 +1,192 @@
+/*
+ *  OpenSlide, a library for reading whole slide image files
+ *
+ *  Copyright (c) 2026 OpenSlide contributors
+ *  All rights reserved.
+ *
+ *  OpenSlide is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation, version 2.1.
+ *
+ *  OpenSlide is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with OpenSlide. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Per-handle stage timing, enabled by OPENSLIDE_DEBUG=performance.
+ *
+ * Reads through a slide handle make the handle's stats current for the
+ * calling thread.  Timers started on that thread then charge their
+ * elapsed time to a stage, minus the time spent in timers nested inside
+ * them, so each interval is charged to exactly one stage.
+ */
+
+#include <config.h>
+
+#include "openslide-private.h"
+
+#include <glib.h>
+
+// bucket 0 is < 1 us; bucket i is < 2^i us; the last bucket is unbounded
+#define BUCKETS 32
+
+static const char *const stage_names[] = {
+  [OPENSLIDE_PERF_IO] = "file I/O",
+  [OPENSLIDE_PERF_DECODE] = "decompression",
+  [OPENSLIDE_PERF_COLOR] = "color conversion",
+  [OPENSLIDE_PERF_CACHE] = "cache",
+  [OPENSLIDE_PERF_COMPOSITE] = "compositing",
+};
+
+struct stage_stats {
+  uint64_t count;
+  int64_t total;
+  int64_t max;
+  uint64_t buckets[BUCKETS];
+};
+
+struct _openslide_perf {
+  char *filename;
+  GMutex lock;
+  struct stage_stats stages[OPENSLIDE_PERF_NUM_STAGES];
+};
+
+struct thread_state {
+  struct _openslide_perf *perf;
+  // time charged to timers that ended inside the running timer
+  int64_t nested;
+};
+
+static GPrivate thread_state = G_PRIVATE_INIT(g_free);
+
+static struct thread_state *get_thread_state(void) {
+  struct thread_state *ts = g_private_get(&thread_state);
+  if (!ts) {
+    ts = g_new0(struct thread_state, 1);
+    g_private_set(&thread_state, ts);
+  }
+  return ts;
+}
+
+struct _openslide_perf *_openslide_perf_create(const char *filename) {
+  if (!_openslide_debug(OPENSLIDE_DEBUG_PERFORMANCE)) {
+    return NULL;
+  }
+  struct _openslide_perf *perf = g_new0(struct _openslide_perf, 1);
+  perf->filename = g_strdup(filename);
+  g_mutex_init(&perf->lock);
+  return perf;
+}
+
+struct _openslide_perf *_openslide_perf_enter(struct _openslide_perf *perf) {
+  if (!perf) {
+    return NULL;
+  }
+  struct thread_state *ts = get_thread_state();
+  struct _openslide_perf *prev = ts->perf;
+  ts->perf = perf;
+  return prev;
+}
+
+void _openslide_perf_leave(struct _openslide_perf *perf,
+                           struct _openslide_perf *prev) {
+  if (!perf) {
+    return;
+  }
+  get_thread_state()->perf = prev;
+}
+
+struct _openslide_perf_timer _openslide_perf_start(enum _openslide_perf_stage stage) {
+  struct _openslide_perf_timer timer = {0};
+  if (!_openslide_debug(OPENSLIDE_DEBUG_PERFORMANCE)) {
+    return timer;
+  }
+  struct thread_state *ts = get_thread_state();
+  if (!ts->perf) {
+    return timer;
+  }
+  timer.stage = stage;
+  timer.nested = ts->nested;
+  ts->nested = 0;
+  timer.start = g_get_monotonic_time();
+  return timer;
+}
+
+void _openslide_perf_end(struct _openslide_perf_timer *timer) {
+  if (!timer->start) {
+    return;
+  }
+  int64_t elapsed = g_get_monotonic_time() - timer->start;
+  timer->start = 0;
+
+  struct thread_state *ts = get_thread_state();
+  int64_t own = MAX(elapsed - ts->nested, 0);
+  ts->nested = timer->nested + elapsed;
+  if (!ts->perf) {
+    return;
+  }
+
+  int bucket = 0;
+  while (bucket < BUCKETS - 1 && own >= ((int64_t) 1 << bucket)) {
+    bucket++;
+  }
+
+  struct _openslide_perf *perf = ts->perf;
+  g_mutex_lock(&perf->lock);
+  struct stage_stats *stats = &perf->stages[timer->stage];
+  stats->count++;
+  stats->total += own;
+  stats->max = MAX(stats->max, own);
+  stats->buckets[bucket]++;
+  g_mutex_unlock(&perf->lock);
+}
+
+static void dump(struct _openslide_perf *perf) {
+  g_autoptr(GString) str = g_string_new(NULL);
+  g_string_append_printf(str, "Stage timings for %s:", perf->filename);
+  g_mutex_lock(&perf->lock);
+  for (int i = 0; i < OPENSLIDE_PERF_NUM_STAGES; i++) {
+    struct stage_stats *stats = &perf->stages[i];
+    if (!stats->count) {
+      continue;
+    }
+    g_string_append_printf(str,
+                           "\n  %-16s %10"PRIu64" calls, %10.3f ms total, "
+                           "%8.1f us mean, %8.3f ms max",
+                           stage_names[i], stats->count,
+                           stats->total / 1000.0,
+                           (double) stats->total / stats->count,
+                           stats->max / 1000.0);
+    g_string_append(str, "\n    us:");
+    for (int bucket = 0; bucket < BUCKETS; bucket++) {
+      if (!stats->buckets[bucket]) {
+        continue;
+      }
+      if (bucket < BUCKETS - 1) {
+        g_string_append_printf(str, " <%"PRId64":%"PRIu64,
+                               (int64_t) 1 << bucket, stats->buckets[bucket]);
+      } else {
+        g_string_append_printf(str, " more:%"PRIu64, stats->buckets[bucket]);
+      }
+    }
+  }
+  g_mutex_unlock(&perf->lock);
+  g_message("%s", str->str);
+}
+
+void _openslide_perf_destroy(struct _openslide_perf *perf) {
+  if (!perf) {
+    return;
+  }
+  dump(perf);
+  g_mutex_clear(&perf->lock);
+  g_free(perf->filename);
+  g_free(perf);
+}
@@ -70,6 +70,11 @@ struct _openslide {
   GHashTable *associated_images;  // created automatically
   const char **associated_image_names; // filled in automatically from hashtable
 
+  // copies of level and associated image geometry, which stay valid while
+  // the handle pool swaps backends, so getters don't need backend_lock
+  struct _openslide_level *level_info;
+  struct _openslide_associated_image *associated_image_info;  // by name index
+
   // metadata
   GHashTable *properties; // created automatically
   const char **property_names; // filled in automatically from hashtable
@@ -82,6 +87,20 @@ struct _openslide {
 
   // error handling, NULL if no error
   gpointer error; // must use g_atomic_pointer!
+
+  // handle number in the access trace, or 0 if not tracing
+  uint32_t trace_handle;
+
+  // stage timings, or NULL if not debugging performance
+  struct _openslide_perf *perf;
+
+  // handle pool
+  char *filename;
+  GRWLock backend_lock;  // held for reading while using the backend
+  openslide_handle_pool_t *pool;  // or NULL
+  GList pool_link;  // data is non-NULL while in the pool's LRU list
+  bool parked;  // backend closed by the pool
+  openslide_t *backend;  // backend reopened after parking, or NULL
 };
 
 struct _openslide_level {
@@ -106,6 +125,8 @@ struct _openslide_ops {
   // must fail if osr->icc_profile_size doesn't match the profile
   bool (*read_icc_profile)(openslide_t *osr, void *dest, GError **err);
   void (*destroy)(openslide_t *osr);
+  // optional; approximate bytes held by the backend, excluding the cache
+  uint64_t (*get_memory_usage)(openslide_t *osr);
 };
 
 struct _openslide_tifflike;
@@ -123,6 +144,10 @@ struct _openslide_tifflike;
  * The hash is stored in a property, it is expected that we will store
  * more hash properties if needed.
  *
+ * The same object also computes quickhash-2 over the same data.  Call
+ * _openslide_hash_disable_quickhash1() rather than _openslide_hash_disable()
+ * when the data is merely too large for quickhash-1.
+ *
  * Suggested data to hash:
  * easily available image metadata + raw compressed lowest resolution image
  */
@@ -146,6 +171,7 @@ extern const struct _openslide_format _openslide_format_mirax;
 extern const struct _openslide_format _openslide_format_philips_tiff;
 extern const struct _openslide_format _openslide_format_sakura;
 extern const struct _openslide_format _openslide_format_synthetic;
+extern const struct _openslide_format _openslide_format_synthetic_slide;
 extern const struct _openslide_format _openslide_format_trestle;
 extern const struct _openslide_format _openslide_format_ventana;
 extern const struct _openslide_format _openslide_format_zeiss;
@@ -202,12 +228,17 @@ struct _openslide_file;
 
 struct _openslide_file *_openslide_fopen(const char *path, GError **err);
 size_t _openslide_fread(struct _openslide_file *file, void *buf, size_t size);
+// read exactly size bytes at offset.  Doesn't use the file position,
+// except on Windows, where it seeks and leaves the position after the data.
+bool _openslide_fread_at(struct _openslide_file *file, off_t offset,
+                         void *buf, size_t size, GError **err);
 bool _openslide_fseek(struct _openslide_file *file, off_t offset, int whence,
                       GError **err);
 off_t _openslide_ftell(struct _openslide_file *file, GError **err);
 off_t _openslide_fsize(struct _openslide_file *file, GError **err);
 void _openslide_fclose(struct _openslide_file *file);
 bool _openslide_fexists(const char *path, GError **err);
+FILE *_openslide_fopen_output(const char *path, GError **err);
 
 typedef struct _openslide_file _openslide_file;
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(_openslide_file, _openslide_fclose)
@@ -293,6 +324,10 @@ bool _openslide_grid_paint_region(struct _openslide_grid *grid,
 
 void _openslide_grid_draw_tile_info(cairo_t *cr, const char *fmt, ...) G_GNUC_PRINTF(2, 3);
 
+// approximate; tile_data_size is the size of each tile's data, if any
+uint64_t _openslide_grid_get_memory_usage(struct _openslide_grid *grid,
+                                          uint64_t tile_data_size);
+
 void _openslide_grid_destroy(struct _openslide_grid *grid);
 
 
@@ -312,6 +347,9 @@ openslide_cache_t *_openslide_cache_create(uint64_t capacity_in_bytes);
 
 void _openslide_cache_release(openslide_cache_t *cache);
 
+void _openslide_cache_get_stats(openslide_cache_t *cache,
+                                uint64_t *hits, uint64_t *misses);
+
 // binding a cache to an openslide_t
 struct _openslide_cache_binding *_openslide_cache_binding_create(uint64_t capacity_in_bytes);
 
@@ -320,6 +358,12 @@ void _openslide_cache_binding_set(struct _openslide_cache_binding *cb,
 
 void _openslide_cache_binding_destroy(struct _openslide_cache_binding *cb);
 
+// bytes of cached tiles belonging to this binding
+uint64_t _openslide_cache_binding_get_size(struct _openslide_cache_binding *cb);
+
+// switch to fresh keys, orphaning tiles cached under the old ones
+void _openslide_cache_binding_renew(struct _openslide_cache_binding *cb);
+
 // put and get
 void _openslide_cache_put(struct _openslide_cache_binding *cb,
                           void *plane,  // coordinate plane (level or grid)
@@ -335,6 +379,13 @@ void *_openslide_cache_get(struct _openslide_cache_binding *cb,
                            int64_t y,
                            struct _openslide_cache_entry **entry);
 
+// get without counting a hit or miss, for rechecking after a counted miss
+void *_openslide_cache_recheck(struct _openslide_cache_binding *cb,
+                               void *plane,
+                               int64_t x,
+                               int64_t y,
+                               struct _openslide_cache_entry **entry);
+
 // value unref
 void _openslide_cache_entry_unref(struct _openslide_cache_entry *entry);
 
@@ -343,6 +394,28 @@ G_DEFINE_AUTOPTR_CLEANUP_FUNC(_openslide_cache_entry,
                               _openslide_cache_entry_unref)
 
 
+/* Handle pool */
+openslide_handle_pool_t *_openslide_handle_pool_create(int32_t max_open);
+
+void _openslide_handle_pool_ref(openslide_handle_pool_t *pool);
+
+void _openslide_handle_pool_unref(openslide_handle_pool_t *pool);
+
+void _openslide_handle_pool_release(openslide_handle_pool_t *pool);
+
+// move to the front of the LRU list, then park idle handles over the
+// limit.  the caller holds osr's backend lock for reading.
+void _openslide_handle_pool_touch(openslide_handle_pool_t *pool,
+                                  openslide_t *osr);
+
+void _openslide_handle_pool_remove(openslide_handle_pool_t *pool,
+                                   openslide_t *osr);
+
+// close the backend, keeping properties and geometry.  the caller holds
+// osr's backend lock for writing.
+void _openslide_park_backend(openslide_t *osr);
+
+
 /* Internal error propagation */
 enum OpenSlideError {
   // generic failure
@@ -380,6 +453,134 @@ void _openslide_performance_warn_once(gint *warned_flag,
                                       const char *str, ...)
                                       G_GNUC_PRINTF(2, 3);
 
+/* Memory accounting */
+// approximate bytes of hash table overhead, excluding keys and values
+uint64_t _openslide_hash_table_overhead(GHashTable *ht);
+
+/* Access tracing */
+void _openslide_trace_init(void);
+
+// returns 0 if tracing is disabled; pass the result to the functions below
+int64_t _openslide_trace_start(void);
+
+void _openslide_trace_open(int64_t start, openslide_t *osr,
+                           const char *filename);
+void _openslide_trace_read_region(int64_t start, openslide_t *osr,
+                                  int64_t x, int64_t y, int32_t level,
+                                  int64_t w, int64_t h);
+void _openslide_trace_read_region_stream(int64_t start, openslide_t *osr,
+                                         int64_t x, int64_t y, int32_t level,
+                                         int64_t w, int64_t h,
+                                         int64_t band_h);
+void _openslide_trace_read_associated_image(int64_t start, openslide_t *osr,
+                                            const char *name);
+void _openslide_trace_close(int64_t start, uint32_t handle);
+
+/* Stage timing, for OPENSLIDE_DEBUG=performance */
+enum _openslide_perf_stage {
+  OPENSLIDE_PERF_IO,
+  OPENSLIDE_PERF_DECODE,
+  OPENSLIDE_PERF_COLOR,
+  OPENSLIDE_PERF_CACHE,
+  OPENSLIDE_PERF_COMPOSITE,
+  OPENSLIDE_PERF_NUM_STAGES,
+};
+
+struct _openslide_perf;
+
+struct _openslide_perf_timer {
+  int64_t start;  // 0 if not timing
+  int64_t nested;
+  enum _openslide_perf_stage stage;
+};
+
+// returns NULL unless debugging performance
+struct _openslide_perf *_openslide_perf_create(const char *filename);
+// logs the timings
+void _openslide_perf_destroy(struct _openslide_perf *perf);
+
+// charge this thread's timers to perf until leave; returns the previous
+// value, which must be passed to leave
+struct _openslide_perf *_openslide_perf_enter(struct _openslide_perf *perf);
+void _openslide_perf_leave(struct _openslide_perf *perf,
+                           struct _openslide_perf *prev);
+
+struct _openslide_perf_timer _openslide_perf_start(enum _openslide_perf_stage stage);
+void _openslide_perf_end(struct _openslide_perf_timer *timer);
+
+typedef struct _openslide_perf_timer _openslide_perf_timer;
+G_DEFINE_AUTO_CLEANUP_CLEAR_FUNC(_openslide_perf_timer, _openslide_perf_end)
+
+/* USDT probes, enabled with -Dusdt=enabled.  Names are as perf and
+ * bpftrace show them, e.g. usdt:libopenslide.so.1:openslide:cache__hit.
+ *
+ *   open                   filename, osr, vendor (NULL if not a slide)
+ *   read__region__start    osr, x, y, level, w, h
+ *   read__region__end      osr, x, y, level, w, h
+ *   cache__hit             cache, x, y
+ *   cache__miss            cache, x, y
+ *   cache__evict           cache, entry size
+ *   decode__start          codec, w, h
+ *   decode__end            codec, w, h
+ *   file__read             file, offset (-1 if sequential), size
+ *   tiff__set__directory   TIFF, old directory, new directory
+ *
+ * For generic decompressors, and for decoders that learn the image size
+ * from the data, w is the output buffer size in bytes and h is 1.
+ *
+ * Each probe has a semaphore, which tracers set while attached.  Wrap a
+ * probe in _OPENSLIDE_PROBE_ENABLED() if its arguments cost anything to
+ * compute.
+ */
+#define _OPENSLIDE_PROBES(X) \
+  X(open) \
+  X(read__region__start) \
+  X(read__region__end) \
+  X(cache__hit) \
+  X(cache__miss) \
+  X(cache__evict) \
+  X(decode__start) \
+  X(decode__end) \
+  X(file__read) \
+  X(tiff__set__directory)
+
+#ifdef HAVE_SYS_SDT_H
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+#define _OPENSLIDE_PROBE_SEMAPHORE(name) \
+  extern unsigned short openslide_##name##_semaphore \
+    __attribute__((section(".probes")));
+_OPENSLIDE_PROBES(_OPENSLIDE_PROBE_SEMAPHORE)
+#define _OPENSLIDE_PROBE(...) STAP_PROBEV(openslide, __VA_ARGS__)
+#define _OPENSLIDE_PROBE_ENABLED(name) \
+  G_UNLIKELY(openslide_##name##_semaphore)
+#else
+#define _OPENSLIDE_PROBE(...) do {} while (0)
+#define _OPENSLIDE_PROBE_ENABLED(name) false
+#endif
+
+struct _openslide_decode_probe {
+  const char *codec;
+  int64_t w;
+  int64_t h;
+};
+
+static inline struct _openslide_decode_probe
+_openslide_decode_probe_start(const char *codec, int64_t w, int64_t h) {
+  _OPENSLIDE_PROBE(decode__start, codec, w, h);
+  return (struct _openslide_decode_probe) { codec, w, h };
+}
+
+static inline void
+_openslide_decode_probe_end(struct _openslide_decode_probe *probe) {
+  (void) probe;
+  _OPENSLIDE_PROBE(decode__end, probe->codec, probe->w, probe->h);
+}
+
+typedef struct _openslide_decode_probe _openslide_decode_probe;
+G_DEFINE_AUTO_CLEANUP_CLEAR_FUNC(_openslide_decode_probe,
+                                 _openslide_decode_probe_end)
+
 // private properties, for now
 #define _OPENSLIDE_PROPERTY_NAME_LEVEL_COUNT "openslide.level-count"
 #define _OPENSLIDE_PROPERTY_NAME_TEMPLATE_LEVEL_WIDTH "openslide.level[%d].width"
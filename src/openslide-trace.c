@@ -0,0 +1,176 @@
+/*
+ *  OpenSlide, a library for reading whole slide image files
+ *
+ *  Copyright (c) 2026 OpenSlide contributors
+ *  All rights reserved.
+ *
+ *  OpenSlide is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation, version 2.1.
+ *
+ *  OpenSlide is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with OpenSlide. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Access tracing, enabled by setting OPENSLIDE_TRACE to a filename.
+ *
+ * The trace starts with a header line beginning with "#", followed by one
+ * tab-separated line per completed call:
+ *
+ *   <start-us> <thread> <duration-us> <handle> <call> <status> [args...]
+ *
+ * start-us is relative to the start of the trace.  thread and handle are
+ * small integers assigned in order of first use.  status is "ok", "error",
+ * or "none" if openslide_open() didn't recognize the file.  Arguments are:
+ *
+ *   open                    <filename>
+ *   read_region             <x> <y> <level> <w> <h>
+ *   read_region_stream      <x> <y> <level> <w> <h> <band-h>
+ *   read_associated_image   <name>
+ *   close
+ *
+ * Strings are escaped with g_strescape().  read_region_stream durations
+ * include the time spent in the caller's band callback.
+ */
+
+#include <config.h>
+
+#include "openslide-private.h"
+
+#include <stdio.h>
+#include <glib.h>
+
+static const char TRACE_ENV_VAR[] = "OPENSLIDE_TRACE";
+
+static FILE *trace_fp;
+static GMutex trace_lock;
+static int64_t trace_epoch;
+
+static GPrivate thread_id;
+static gint next_thread_id;
+static gint next_handle_id;
+
+// note: g_getenv() is not reentrant
+void _openslide_trace_init(void) {
+  const char *path = g_getenv(TRACE_ENV_VAR);
+  if (!path || !*path) {
+    return;
+  }
+
+  GError *tmp_err = NULL;
+  FILE *fp = _openslide_fopen_output(path, &tmp_err);
+  if (!fp) {
+    g_warning("Couldn't start trace: %s", tmp_err->message);
+    g_error_free(tmp_err);
+    return;
+  }
+  // one write per record
+  setvbuf(fp, NULL, _IOLBF, 0);
+
+  g_autoptr(GDateTime) now = g_date_time_new_now_utc();
+  g_autofree char *timestamp = g_date_time_format(now, "%FT%TZ");
+  fprintf(fp, "# OpenSlide trace 1, %s, started %s\n",
+          openslide_get_version(), timestamp);
+
+  trace_epoch = g_get_monotonic_time();
+  trace_fp = fp;
+}
+
+int64_t _openslide_trace_start(void) {
+  if (!trace_fp) {
+    return 0;
+  }
+  return g_get_monotonic_time();
+}
+
+static uint32_t get_thread_id(void) {
+  uint32_t id = GPOINTER_TO_UINT(g_private_get(&thread_id));
+  if (!id) {
+    id = g_atomic_int_add(&next_thread_id, 1) + 1;
+    g_private_set(&thread_id, GUINT_TO_POINTER(id));
+  }
+  return id;
+}
+
+static void emit(int64_t start, uint32_t handle, const char *call,
+                 const char *status, const char *args) {
+  int64_t end = g_get_monotonic_time();
+  g_autofree char *line =
+    g_strdup_printf("%"PRId64"\t%u\t%"PRId64"\t%u\t%s\t%s%s%s\n",
+                    start - trace_epoch, get_thread_id(), end - start,
+                    handle, call, status, args ? "\t" : "", args ? args : "");
+  g_mutex_lock(&trace_lock);
+  fputs(line, trace_fp);
+  g_mutex_unlock(&trace_lock);
+}
+
+static const char *get_status(openslide_t *osr) {
+  if (!osr) {
+    return "none";
+  }
+  return openslide_get_error(osr) ? "error" : "ok";
+}
+
+void _openslide_trace_open(int64_t start, openslide_t *osr,
+                           const char *filename) {
+  if (!start) {
+    return;
+  }
+  uint32_t handle = 0;
+  if (osr) {
+    handle = osr->trace_handle = g_atomic_int_add(&next_handle_id, 1) + 1;
+  }
+  g_autofree char *escaped = g_strescape(filename, NULL);
+  emit(start, handle, "open", get_status(osr), escaped);
+}
+
+void _openslide_trace_read_region(int64_t start, openslide_t *osr,
+                                  int64_t x, int64_t y, int32_t level,
+                                  int64_t w, int64_t h) {
+  if (!start) {
+    return;
+  }
+  g_autofree char *args =
+    g_strdup_printf("%"PRId64"\t%"PRId64"\t%d\t%"PRId64"\t%"PRId64,
+                    x, y, level, w, h);
+  emit(start, osr->trace_handle, "read_region", get_status(osr), args);
+}
+
+void _openslide_trace_read_region_stream(int64_t start, openslide_t *osr,
+                                         int64_t x, int64_t y, int32_t level,
+                                         int64_t w, int64_t h,
+                                         int64_t band_h) {
+  if (!start) {
+    return;
+  }
+  g_autofree char *args =
+    g_strdup_printf("%"PRId64"\t%"PRId64"\t%d\t%"PRId64"\t%"PRId64
+                    "\t%"PRId64, x, y, level, w, h, band_h);
+  emit(start, osr->trace_handle, "read_region_stream", get_status(osr),
+       args);
+}
+
+void _openslide_trace_read_associated_image(int64_t start, openslide_t *osr,
+                                            const char *name) {
+  if (!start) {
+    return;
+  }
+  g_autofree char *escaped = g_strescape(name, NULL);
+  emit(start, osr->trace_handle, "read_associated_image", get_status(osr),
+       escaped);
+}
+
+void _openslide_trace_close(int64_t start, uint32_t handle) {
+  if (!start) {
+    return;
+  }
+  emit(start, handle, "close", "ok", NULL);
+}
@@ -20,6 +20,8 @@
  *
  */
 
+#include <config.h>
+
 #include "openslide-private.h"
 
 #include <stdio.h>
@@ -32,6 +34,14 @@
 #include <zlib.h>
 #include <zstd.h>
 
+#ifdef HAVE_SYS_SDT_H
+// USDT probe semaphores
+#define DEFINE_PROBE_SEMAPHORE(name) \
+  unsigned short openslide_##name##_semaphore \
+    __attribute__((section(".probes")));
+_OPENSLIDE_PROBES(DEFINE_PROBE_SEMAPHORE)
+#endif
+
 #define KEY_FILE_HARD_MAX_SIZE (100 << 20)
 
 static const char DEBUG_ENV_VAR[] = "OPENSLIDE_DEBUG";
@@ -47,7 +57,7 @@ static const struct debug_option {
   {"jpeg-markers", OPENSLIDE_DEBUG_JPEG_MARKERS,
    "verify Hamamatsu restart markers"},
   {"performance", OPENSLIDE_DEBUG_PERFORMANCE,
-   "log conditions causing poor performance"},
+   "log conditions causing poor performance, and stage timings at close"},
   {"search", OPENSLIDE_DEBUG_SEARCH,
    "log skipped files when searching directory"},
   {"sql", OPENSLIDE_DEBUG_SQL,
@@ -146,6 +156,10 @@ static void zlib_error(z_stream *strm, int64_t dst_len, int error_code,
 void *_openslide_inflate_buffer(const void *src, int64_t src_len,
                                 int64_t dst_len,
                                 GError **err) {
+  g_auto(_openslide_perf_timer) timer G_GNUC_UNUSED =
+    _openslide_perf_start(OPENSLIDE_PERF_DECODE);
+  g_auto(_openslide_decode_probe) probe G_GNUC_UNUSED =
+    _openslide_decode_probe_start("deflate", dst_len, 1);
   g_autofree void *dst = g_malloc(dst_len);
   z_stream strm = {
     .avail_in = src_len,
@@ -175,6 +189,10 @@ void *_openslide_inflate_buffer(const void *src, int64_t src_len,
 
 void *_openslide_zstd_decompress_buffer(const void *src, int64_t src_len,
                                         int64_t dst_len, GError **err) {
+  g_auto(_openslide_perf_timer) timer G_GNUC_UNUSED =
+    _openslide_perf_start(OPENSLIDE_PERF_DECODE);
+  g_auto(_openslide_decode_probe) probe G_GNUC_UNUSED =
+    _openslide_decode_probe_start("zstd", dst_len, 1);
   g_autofree void *dst = g_try_malloc(dst_len);
   if (!dst) {
     g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
@@ -401,3 +419,13 @@ void _openslide_performance_warn_once(gint *warned_flag,
     }
   }
 }
+
+uint64_t _openslide_hash_table_overhead(GHashTable *ht) {
+  if (!ht) {
+    return 0;
+  }
+  // GLib keeps a hash, key, and value slot per bucket, and grows the
+  // table to at most twice the entry count
+  return g_hash_table_size(ht) * 2 *
+         (sizeof(guint) + 2 * sizeof(gpointer));
+}
@@ -75,51 +75,107 @@ static void destroy(openslide_t *osr) {
   g_free(data);
 }
 
-static bool render_missing_tile(struct level *l,
+static bool get_tile(openslide_t *osr,
+                     struct level *l,
+                     TIFF *tiff,
+                     int64_t tile_col, int64_t tile_row,
+                     uint32_t **tiledata,
+                     struct _openslide_cache_entry **cache_entry,
+                     GError **err);
+
+// Synthesize a missing tile by box-downscaling the covering pixels of the
+// previous level.  Source tiles (including synthesized ones) come from the
+// tile cache, so chains of missing tiles are only rendered once.
+static bool render_missing_tile(openslide_t *osr,
+                                struct level *l,
                                 TIFF *tiff,
                                 uint32_t *dest,
                                 int64_t tile_col, int64_t tile_row,
                                 GError **err) {
   int64_t tw = l->tiffl.tile_w;
   int64_t th = l->tiffl.tile_h;
-
-  // always fill with transparent (needed for SATURATE)
-  memset(dest, 0, tw * th * 4);
-
-  if (l->prev == NULL) {
-    // no previous levels; nothing to do
+  struct level *prev = l->prev;
+  if (prev == NULL) {
+    // no previous levels; transparent
+    memset(dest, 0, tw * th * 4);
+    return true;
+  }
+  int64_t ptw = prev->tiffl.tile_w;
+  int64_t pth = prev->tiffl.tile_h;
+
+  // source pixel sx belongs to dest pixel floor(sx / ratio)
+  double ratio = l->base.downsample / prev->base.downsample;
+  int64_t sx0 = ceil(tile_col * tw * ratio);
+  int64_t sy0 = ceil(tile_row * th * ratio);
+  int64_t sx1 = MIN((int64_t) ceil((tile_col + 1) * tw * ratio),
+                    prev->tiffl.image_w);
+  int64_t sy1 = MIN((int64_t) ceil((tile_row + 1) * th * ratio),
+                    prev->tiffl.image_h);
+  if (sx1 <= sx0 || sy1 <= sy0) {
+    memset(dest, 0, tw * th * 4);
     return true;
   }
 
-  // recurse into previous level
-  double relative_ds = l->prev->base.downsample / l->base.downsample;
+  g_autofree int32_t *xmap = g_new(int32_t, sx1 - sx0);
+  for (int64_t sx = sx0; sx < sx1; sx++) {
+    xmap[sx - sx0] = CLAMP((int64_t) (sx / ratio) - tile_col * tw, 0, tw - 1);
+  }
+  g_autofree int32_t *ymap = g_new(int32_t, sy1 - sy0);
+  for (int64_t sy = sy0; sy < sy1; sy++) {
+    ymap[sy - sy0] = CLAMP((int64_t) (sy / ratio) - tile_row * th, 0, th - 1);
+  }
 
-  g_autoptr(cairo_surface_t) surface =
-    cairo_image_surface_create_for_data((unsigned char *) dest,
-                                        CAIRO_FORMAT_ARGB32,
-                                        tw, th, tw * 4);
-  g_autoptr(cairo_t) cr = cairo_create(surface);
-  cairo_set_operator(cr, CAIRO_OPERATOR_SATURATE);
-  cairo_translate(cr, -1, -1);
-  cairo_scale(cr, relative_ds, relative_ds);
-
-  // For the usual case that we are on a tile boundary in the previous
-  // level, extend the region by one pixel in each direction to ensure we
-  // paint the surrounding tiles.  This reduces the visible seam that
-  // would otherwise occur with non-integer downsamples.
-  if (!_openslide_grid_paint_region(l->prev->grid, cr, tiff,
-                                    (tile_col * tw - 1) / relative_ds,
-                                    (tile_row * th - 1) / relative_ds,
-                                    (struct _openslide_level *) l->prev,
-                                    ceil((tw + 2) / relative_ds),
-                                    ceil((th + 2) / relative_ds),
-                                    err)) {
-    return false;
+  // accumulate premultiplied channels, one source tile at a time
+  g_autofree uint32_t *sums = g_new0(uint32_t, tw * th * 4);
+  g_autofree uint32_t *counts = g_new0(uint32_t, tw * th);
+  for (int64_t row = sy0 / pth; row * pth < sy1; row++) {
+    for (int64_t col = sx0 / ptw; col * ptw < sx1; col++) {
+      g_autoptr(_openslide_cache_entry) cache_entry = NULL;
+      uint32_t *src;
+      if (!get_tile(osr, prev, tiff, col, row, &src, &cache_entry, err)) {
+        return false;
+      }
+
+      int64_t x_start = MAX(sx0, col * ptw);
+      int64_t x_end = MIN(sx1, (col + 1) * ptw);
+      int64_t y_start = MAX(sy0, row * pth);
+      int64_t y_end = MIN(sy1, (row + 1) * pth);
+      for (int64_t sy = y_start; sy < y_end; sy++) {
+        const uint32_t *src_row = src + (sy - row * pth) * ptw;
+        int64_t dy = ymap[sy - sy0];
+        uint32_t *sum_row = sums + dy * tw * 4;
+        uint32_t *count_row = counts + dy * tw;
+        for (int64_t sx = x_start; sx < x_end; sx++) {
+          uint32_t p = src_row[sx - col * ptw];
+          int32_t dx = xmap[sx - sx0];
+          uint32_t *sum = sum_row + dx * 4;
+          sum[0] += p >> 24;
+          sum[1] += (p >> 16) & 0xff;
+          sum[2] += (p >> 8) & 0xff;
+          sum[3] += p & 0xff;
+          count_row[dx]++;
+        }
+      }
+    }
   }
-  return _openslide_check_cairo_status(cr, err);
+
+  for (int64_t i = 0; i < tw * th; i++) {
+    uint32_t c = counts[i];
+    if (c == 0) {
+      dest[i] = 0;
+      continue;
+    }
+    const uint32_t *sum = sums + i * 4;
+    dest[i] = ((sum[0] + c / 2) / c) << 24 |
+              ((sum[1] + c / 2) / c) << 16 |
+              ((sum[2] + c / 2) / c) << 8 |
+              ((sum[3] + c / 2) / c);
+  }
+  return true;
 }
 
-static bool decode_tile(struct level *l,
+static bool decode_tile(openslide_t *osr,
+                        struct level *l,
                         TIFF *tiff,
                         uint32_t *dest,
                         int64_t tile_col, int64_t tile_row,
@@ -130,7 +186,7 @@ static bool decode_tile(struct level *l,
   int64_t tile_no = tile_row * tiffl->tiles_across + tile_col;
   if (g_hash_table_lookup_extended(l->missing_tiles, &tile_no, NULL, NULL)) {
     //g_debug("missing tile in level %p: (%"PRId64", %"PRId64")", (void *) l, tile_col, tile_row);
-    return render_missing_tile(l, tiff, dest,
+    return render_missing_tile(osr, l, tiff, dest,
                                tile_col, tile_row, err);
   }
 
@@ -168,6 +224,47 @@ static bool decode_tile(struct level *l,
                                        err);
 }
 
+static bool get_tile(openslide_t *osr,
+                     struct level *l,
+                     TIFF *tiff,
+                     int64_t tile_col, int64_t tile_row,
+                     uint32_t **tiledata,
+                     struct _openslide_cache_entry **cache_entry,
+                     GError **err) {
+  struct _openslide_tiff_level *tiffl = &l->tiffl;
+
+  // tile size
+  int64_t tw = tiffl->tile_w;
+  int64_t th = tiffl->tile_h;
+
+  // cache
+  *tiledata = _openslide_cache_get(osr->cache,
+                                   &l->base, tile_col, tile_row,
+                                   cache_entry);
+  if (*tiledata) {
+    return true;
+  }
+
+  g_autofree uint32_t *buf = g_malloc(tw * th * 4);
+  if (!decode_tile(osr, l, tiff, buf, tile_col, tile_row, err)) {
+    return false;
+  }
+
+  // clip, if necessary
+  if (!_openslide_tiff_clip_tile(tiffl, buf,
+                                 tile_col, tile_row,
+                                 err)) {
+    return false;
+  }
+
+  // put it in the cache
+  *tiledata = g_steal_pointer(&buf);
+  _openslide_cache_put(osr->cache, &l->base, tile_col, tile_row,
+                       *tiledata, tw * th * 4,
+                       cache_entry);
+  return true;
+}
+
 static bool read_tile(openslide_t *osr,
 		      cairo_t *cr,
 		      struct _openslide_level *level,
@@ -184,27 +281,10 @@ static bool read_tile(openslide_t *osr,
 
   // cache
   g_autoptr(_openslide_cache_entry) cache_entry = NULL;
-  uint32_t *tiledata = _openslide_cache_get(osr->cache,
-                                            level, tile_col, tile_row,
-                                            &cache_entry);
-  if (!tiledata) {
-    g_autofree uint32_t *buf = g_malloc(tw * th * 4);
-    if (!decode_tile(l, tiff, buf, tile_col, tile_row, err)) {
-      return false;
-    }
-
-    // clip, if necessary
-    if (!_openslide_tiff_clip_tile(tiffl, buf,
-                                   tile_col, tile_row,
-                                   err)) {
-      return false;
-    }
-
-    // put it in the cache
-    tiledata = g_steal_pointer(&buf);
-    _openslide_cache_put(osr->cache, level, tile_col, tile_row,
-			 tiledata, tw * th * 4,
-			 &cache_entry);
+  uint32_t *tiledata;
+  if (!get_tile(osr, l, tiff, tile_col, tile_row, &tiledata, &cache_entry,
+                err)) {
+    return false;
   }
 
   // draw it
@@ -250,10 +330,27 @@ static bool read_icc_profile(openslide_t *osr, void *dest, GError **err) {
   return _openslide_tiff_read_icc_profile(osr, &l->tiffl, ct.tiff, dest, err);
 }
 
+static uint64_t get_memory_usage(openslide_t *osr) {
+  struct aperio_ops_data *data = osr->data;
+  uint64_t total = sizeof(*data) +
+    _openslide_tiffcache_get_memory_usage(data->tc);
+  for (int32_t i = 0; i < osr->level_count; i++) {
+    struct level *l = (struct level *) osr->levels[i];
+    total += sizeof(*l) +
+      _openslide_grid_get_memory_usage(l->grid, 0);
+    if (l->missing_tiles) {
+      total += _openslide_hash_table_overhead(l->missing_tiles) +
+        g_hash_table_size(l->missing_tiles) * sizeof(int64_t);
+    }
+  }
+  return total;
+}
+
 static const struct _openslide_ops aperio_ops = {
   .paint_region = paint_region,
   .read_icc_profile = read_icc_profile,
   .destroy = destroy,
+  .get_memory_usage = get_memory_usage,
 };
 
 static bool aperio_detect(const char *filename G_GNUC_UNUSED,
@@ -161,10 +161,23 @@ static bool read_icc_profile(openslide_t *osr, void *dest, GError **err) {
   return _openslide_tiff_read_icc_profile(osr, &l->tiffl, ct.tiff, dest, err);
 }
 
+static uint64_t get_memory_usage(openslide_t *osr) {
+  struct generic_tiff_ops_data *data = osr->data;
+  uint64_t total = sizeof(*data) +
+    _openslide_tiffcache_get_memory_usage(data->tc);
+  for (int32_t i = 0; i < osr->level_count; i++) {
+    struct level *l = (struct level *) osr->levels[i];
+    total += sizeof(*l) +
+      _openslide_grid_get_memory_usage(l->grid, 0);
+  }
+  return total;
+}
+
 static const struct _openslide_ops generic_tiff_ops = {
   .paint_region = paint_region,
   .read_icc_profile = read_icc_profile,
   .destroy = destroy,
+  .get_memory_usage = get_memory_usage,
 };
 
 static bool generic_tiff_detect(const char *filename G_GNUC_UNUSED,
@@ -56,6 +56,8 @@
 
 #define NGR_TILE_HEIGHT 64
 
+#define JPEG_HANDLE_CACHE_MAX 8
+
 // VMS/VMU
 static const char GROUP_VMS[] = "Virtual Microscope Specimen";
 static const char GROUP_VMU[] = "Uncompressed Virtual Microscope Specimen";
@@ -94,8 +96,17 @@ static const int KEY_FILE_MAX_SIZE = 64 << 10;
     }									\
   } while (0)
 
+// pool of open handles to one JPEG file, shared by every struct jpeg
+// stored in that file
+struct jpeg_file {
+  char *filename;
+  GQueue *handles;
+  GMutex lock;
+};
+
 struct jpeg {
   char *filename;
+  struct jpeg_file *file;  // doesn't own the file
   int64_t start_in_file;
   int64_t end_in_file;
 
@@ -112,6 +123,10 @@ struct jpeg {
 
   int64_t sof_position;
   int64_t header_stop_position;
+
+  // header from start_in_file to header_stop_position, loaded on first
+  // read and protected by header_lock
+  uint8_t *header;
 };
 
 struct jpeg_level {
@@ -139,6 +154,8 @@ struct jpeg_setup {
 struct hamamatsu_jpeg_ops_data {
   int32_t jpeg_count;
   struct jpeg **all_jpegs;
+  GHashTable *jpeg_files;  // filename -> struct jpeg_file
+  GMutex header_lock;
 
   // thread stuff, for background search of restart markers
   int64_t restart_marker_last_used_time;
@@ -173,39 +190,84 @@ static GQuark _openslide_hamamatsu_error_quark(void) {
 }
 #define OPENSLIDE_HAMAMATSU_ERROR _openslide_hamamatsu_error_quark()
 
+// read the JPEG header, from SOI through SOS, into a newly allocated buffer
+static uint8_t *read_jpeg_header(struct _openslide_file *f,
+                                 int64_t header_start_position,
+                                 int64_t sof_position,
+                                 int64_t header_stop_position,
+                                 GError **err) {
+  // check for problems
+  if ((0 > header_start_position) ||
+      (header_start_position >= sof_position) ||
+      (sof_position + 9 >= header_stop_position)) {
+    g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+               "Can't read JPEG header: "
+	       "header_start_position: %"PRId64", "
+	       "sof_position: %"PRId64", "
+	       "header_stop_position: %"PRId64,
+	       header_start_position, sof_position, header_stop_position);
+    return NULL;
+  }
+
+  int64_t header_length = header_stop_position - header_start_position;
+  g_autofree uint8_t *buffer = g_malloc(header_length);
+  //  g_debug("reading header from %"PRId64, header_start_position);
+  if (!_openslide_fread_at(f, header_start_position, buffer, header_length,
+                           err)) {
+    g_prefix_error(err, "Cannot read header in JPEG at %"PRId64": ",
+                   header_start_position);
+    return NULL;
+  }
+
+  // check for overlarge or 0 X/Y in SOF (some NDPI JPEGs have this)
+  // change them to a value libjpeg will accept
+  int64_t size_offset = sof_position - header_start_position + 5;
+  uint16_t y = (buffer[size_offset + 0] << 8) +
+                buffer[size_offset + 1];
+  if (y > JPEG_MAX_DIMENSION || y == 0) {
+    //g_debug("fixing up SOF Y");
+    buffer[size_offset + 0] = JPEG_MAX_DIMENSION_HIGH;
+    buffer[size_offset + 1] = JPEG_MAX_DIMENSION_LOW;
+  }
+  uint16_t x = (buffer[size_offset + 2] << 8) +
+                buffer[size_offset + 3];
+  if (x > JPEG_MAX_DIMENSION || x == 0) {
+    //g_debug("fixing up SOF X");
+    buffer[size_offset + 2] = JPEG_MAX_DIMENSION_HIGH;
+    buffer[size_offset + 3] = JPEG_MAX_DIMENSION_LOW;
+  }
+
+  return g_steal_pointer(&buffer);
+}
+
 /*
  * Source manager for reading a run of MCUs between two restart markers
  * as a complete JPEG.  Originally based on jdatasrc.c from IJG libjpeg.
+ * The header comes from read_jpeg_header(); the MCU run is read with a
+ * single positional read directly into the assembled buffer.
  */
 static bool jpeg_random_access_src(j_decompress_ptr cinfo,
                                    struct _openslide_file *infile,
-                                   int64_t header_start_position,
-                                   int64_t sof_position,
+                                   const uint8_t *header,
+                                   int64_t header_length,
                                    int64_t header_stop_position,
                                    int64_t start_position,
                                    int64_t stop_position,
                                    GError **err) {
   // check for problems
-  if ((0 > header_start_position) ||
-      (header_start_position >= sof_position) ||
-      (sof_position + 9 >= header_stop_position) ||
-      (start_position != -1 &&
-       ((header_stop_position > start_position) ||
-        (start_position >= stop_position)))) {
+  if (start_position != -1 &&
+      ((header_stop_position > start_position) ||
+       (start_position >= stop_position))) {
     g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
                "Can't do random access JPEG read: "
-	       "header_start_position: %"PRId64", "
-	       "sof_position: %"PRId64", "
 	       "header_stop_position: %"PRId64", "
 	       "start_position: %"PRId64", "
 	       "stop_position: %"PRId64,
-	       header_start_position, sof_position, header_stop_position,
-	       start_position, stop_position);
+	       header_stop_position, start_position, stop_position);
     return false;
   }
 
   // compute size of buffer and allocate
-  int header_length = header_stop_position - header_start_position;
   int data_length = 0;
   if (start_position != -1) {
     data_length = stop_position - start_position;
@@ -216,30 +278,14 @@ static bool jpeg_random_access_src(j_decompress_ptr cinfo,
   JOCTET *buffer = (*cinfo->mem->alloc_large)((j_common_ptr) cinfo,
                                               JPOOL_IMAGE, buffer_size);
 
-  // read in the 2 parts
-  //  g_debug("reading header from %"PRId64, header_start_position);
-  if (!_openslide_fseek(infile, header_start_position, SEEK_SET, err)) {
-    g_prefix_error(err, "Couldn't seek to header start: ");
-    return false;
-  }
-  if (_openslide_fread(infile, buffer, header_length) !=
-      (size_t) header_length) {
-    g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
-                "Cannot read header in JPEG at %"PRId64,
-                header_start_position);
-    return false;
-  }
-
+  // assemble the 2 parts
+  memcpy(buffer, header, header_length);
   if (data_length) {
     //  g_debug("reading from %"PRId64, start_position);
-    if (!_openslide_fseek(infile, start_position, SEEK_SET, err)) {
-      g_prefix_error(err, "Couldn't seek to data start: ");
-      return false;
-    }
-    if (_openslide_fread(infile, buffer + header_length, data_length) !=
-        (size_t) data_length) {
-      g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
-                  "Cannot read data in JPEG at %"PRId64, start_position);
+    if (!_openslide_fread_at(infile, start_position,
+                             buffer + header_length, data_length, err)) {
+      g_prefix_error(err, "Cannot read data in JPEG at %"PRId64": ",
+                     start_position);
       return false;
     }
 
@@ -252,24 +298,6 @@ static bool jpeg_random_access_src(j_decompress_ptr cinfo,
     buffer[buffer_size - 1] = JPEG_EOI;
   }
 
-  // check for overlarge or 0 X/Y in SOF (some NDPI JPEGs have this)
-  // change them to a value libjpeg will accept
-  int64_t size_offset = sof_position - header_start_position + 5;
-  uint16_t y = (buffer[size_offset + 0] << 8) +
-                buffer[size_offset + 1];
-  if (y > JPEG_MAX_DIMENSION || y == 0) {
-    //g_debug("fixing up SOF Y");
-    buffer[size_offset + 0] = JPEG_MAX_DIMENSION_HIGH;
-    buffer[size_offset + 1] = JPEG_MAX_DIMENSION_LOW;
-  }
-  uint16_t x = (buffer[size_offset + 2] << 8) +
-                buffer[size_offset + 3];
-  if (x > JPEG_MAX_DIMENSION || x == 0) {
-    //g_debug("fixing up SOF X");
-    buffer[size_offset + 2] = JPEG_MAX_DIMENSION_HIGH;
-    buffer[size_offset + 3] = JPEG_MAX_DIMENSION_LOW;
-  }
-
   // pass the buffer off to mem_src
   _openslide_jpeg_mem_src(cinfo, buffer, buffer_size);
 
@@ -290,9 +318,57 @@ static void jpeg_free(struct jpeg *jpeg) {
   g_free(jpeg->filename);
   g_free(jpeg->mcu_starts);
   g_free(jpeg->unreliable_mcu_starts);
+  g_free(jpeg->header);
   g_free(jpeg);
 }
 
+static struct jpeg_file *jpeg_file_new(const char *filename) {
+  struct jpeg_file *jf = g_new0(struct jpeg_file, 1);
+  jf->filename = g_strdup(filename);
+  jf->handles = g_queue_new();
+  g_mutex_init(&jf->lock);
+  return jf;
+}
+
+static void jpeg_file_free(struct jpeg_file *jf) {
+  struct _openslide_file *f;
+  while ((f = g_queue_pop_head(jf->handles)) != NULL) {
+    _openslide_fclose(f);
+  }
+  g_queue_free(jf->handles);
+  g_mutex_clear(&jf->lock);
+  g_free(jf->filename);
+  g_free(jf);
+}
+
+// get an open handle from the pool, or open a new one
+static struct _openslide_file *jpeg_file_get(struct jpeg_file *jf,
+                                             GError **err) {
+  g_mutex_lock(&jf->lock);
+  struct _openslide_file *f = g_queue_pop_head(jf->handles);
+  g_mutex_unlock(&jf->lock);
+
+  if (f == NULL) {
+    f = _openslide_fopen(jf->filename, err);
+  }
+  return f;
+}
+
+// return a handle to the pool, or close it if the pool is full
+static void jpeg_file_put(struct jpeg_file *jf, struct _openslide_file *f) {
+  if (f == NULL) {
+    return;
+  }
+  g_mutex_lock(&jf->lock);
+  if (g_queue_get_length(jf->handles) < JPEG_HANDLE_CACHE_MAX) {
+    g_queue_push_head(jf->handles, g_steal_pointer(&f));
+  }
+  g_mutex_unlock(&jf->lock);
+  if (f) {
+    _openslide_fclose(f);
+  }
+}
+
 static struct jpeg_setup *jpeg_setup_new(void) {
   struct jpeg_setup *setup = g_new0(struct jpeg_setup, 1);
   setup->levels =
@@ -584,16 +660,44 @@ static bool compute_mcu_start(openslide_t *osr,
   return true;
 }
 
-static bool read_from_jpeg(openslide_t *osr,
-                           struct jpeg *jpeg,
-                           int32_t tileno,
-                           int32_t scale_denom,
-                           uint32_t *dest,
-                           int32_t w, int32_t h,
-                           GError **err) {
-  // open file
-  g_autoptr(_openslide_file) f = _openslide_fopen(jpeg->filename, err);
-  if (f == NULL) {
+static const uint8_t *get_jpeg_header(openslide_t *osr,
+                                      struct jpeg *jpeg,
+                                      struct _openslide_file *f,
+                                      GError **err) {
+  struct hamamatsu_jpeg_ops_data *data = osr->data;
+
+  uint8_t *header = g_atomic_pointer_get(&jpeg->header);
+  if (header) {
+    return header;
+  }
+
+  g_autoptr(GMutexLocker) locker G_GNUC_UNUSED =
+    g_mutex_locker_new(&data->header_lock);
+  if (!jpeg->header) {
+    header = read_jpeg_header(f,
+                              jpeg->start_in_file,
+                              jpeg->sof_position,
+                              jpeg->header_stop_position,
+                              err);
+    if (!header) {
+      return NULL;
+    }
+    g_atomic_pointer_set(&jpeg->header, header);
+  }
+  return jpeg->header;
+}
+
+static bool read_from_jpeg_file(openslide_t *osr,
+                                struct jpeg *jpeg,
+                                struct _openslide_file *f,
+                                int32_t tileno,
+                                int32_t scale_denom,
+                                uint32_t *dest,
+                                int32_t w, int32_t h,
+                                GError **err) {
+  // get the header, reading it if we haven't yet
+  const uint8_t *header = get_jpeg_header(osr, jpeg, f, err);
+  if (!header) {
     return false;
   }
 
@@ -617,8 +721,9 @@ static bool read_from_jpeg(openslide_t *osr,
     _openslide_jpeg_decompress_init(dc, &env);
 
     if (!jpeg_random_access_src(cinfo, f,
+                                header,
+                                jpeg->header_stop_position -
                                 jpeg->start_in_file,
-                                jpeg->sof_position,
                                 jpeg->header_stop_position,
                                 start_position,
                                 stop_position,
@@ -647,6 +752,30 @@ static bool read_from_jpeg(openslide_t *osr,
   }
 }
 
+static bool read_from_jpeg(openslide_t *osr,
+                           struct jpeg *jpeg,
+                           int32_t tileno,
+                           int32_t scale_denom,
+                           uint32_t *dest,
+                           int32_t w, int32_t h,
+                           GError **err) {
+  // get file handle
+  struct _openslide_file *f = jpeg_file_get(jpeg->file, err);
+  if (f == NULL) {
+    return false;
+  }
+
+  if (!read_from_jpeg_file(osr, jpeg, f, tileno, scale_denom,
+                           dest, w, h, err)) {
+    // don't reuse a handle in an unknown state
+    _openslide_fclose(f);
+    return false;
+  }
+
+  jpeg_file_put(jpeg->file, f);
+  return true;
+}
+
 static bool read_jpeg_tile(openslide_t *osr,
                            cairo_t *cr,
                            struct _openslide_level *level,
@@ -772,6 +901,9 @@ static void jpeg_do_destroy(openslide_t *osr) {
     jpeg_free(data->all_jpegs[i]);
   }
   g_free(data->all_jpegs);
+  if (data->jpeg_files) {
+    g_hash_table_destroy(data->jpeg_files);
+  }
 
   // levels
   for (int32_t i = 0; i < osr->level_count; i++) {
@@ -790,14 +922,56 @@ static void jpeg_do_destroy(openslide_t *osr) {
   g_mutex_clear(&data->restart_marker_mutex);
   g_cond_clear(&data->restart_marker_cond);
   g_mutex_clear(&data->restart_marker_cond_mutex);
+  g_mutex_clear(&data->header_lock);
 
   // the structure
   g_free(data);
 }
 
+static uint64_t jpeg_get_memory_usage(openslide_t *osr) {
+  struct hamamatsu_jpeg_ops_data *data = osr->data;
+  uint64_t total = sizeof(*data) + data->jpeg_count * sizeof(struct jpeg *);
+
+  // JPEGs and their restart marker indexes
+  g_mutex_lock(&data->header_lock);
+  for (int32_t i = 0; i < data->jpeg_count; i++) {
+    struct jpeg *jp = data->all_jpegs[i];
+    total += sizeof(*jp) + strlen(jp->filename) + 1;
+    total += jp->tile_count * sizeof(int64_t) *
+             (jp->unreliable_mcu_starts ? 2 : 1);
+    if (jp->header) {
+      total += jp->header_stop_position - jp->start_in_file;
+    }
+  }
+  g_mutex_unlock(&data->header_lock);
+
+  // pooled file handles, each with a stdio buffer
+  if (data->jpeg_files) {
+    total += _openslide_hash_table_overhead(data->jpeg_files);
+    GHashTableIter iter;
+    void *value;
+    g_hash_table_iter_init(&iter, data->jpeg_files);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+      struct jpeg_file *jf = value;
+      g_mutex_lock(&jf->lock);
+      total += sizeof(*jf) + strlen(jf->filename) + 1 +
+               g_queue_get_length(jf->handles) * BUFSIZ;
+      g_mutex_unlock(&jf->lock);
+    }
+  }
+
+  for (int32_t i = 0; i < osr->level_count; i++) {
+    struct jpeg_level *l = (struct jpeg_level *) osr->levels[i];
+    total += sizeof(*l) + _openslide_grid_get_memory_usage(l->grid, 0) +
+             (int64_t) l->jpegs_across * l->jpegs_down * sizeof(struct jpeg *);
+  }
+  return total;
+}
+
 static const struct _openslide_ops hamamatsu_jpeg_ops = {
   .paint_region = jpeg_paint_region,
   .destroy = jpeg_do_destroy,
+  .get_memory_usage = jpeg_get_memory_usage,
 };
 
 static bool hamamatsu_vms_vmu_detect(const char *filename,
@@ -895,7 +1069,7 @@ static gpointer restart_marker_thread_func(gpointer d) {
   int32_t current_jpeg = 0;
   int32_t current_mcu_start = 0;
 
-  g_autoptr(_openslide_file) current_file = NULL;
+  struct _openslide_file *current_file = NULL;
 
   GError *tmp_err = NULL;
 
@@ -939,7 +1113,7 @@ static gpointer restart_marker_thread_func(gpointer d) {
     struct jpeg *jp = data->all_jpegs[current_jpeg];
     if (jp->tile_count > 1) {
       if (current_file == NULL) {
-	current_file = _openslide_fopen(jp->filename, &tmp_err);
+	current_file = jpeg_file_get(jp->file, &tmp_err);
 	if (current_file == NULL) {
 	  //g_debug("restart_marker_thread_func fopen failed");
 	  break;
@@ -949,6 +1123,7 @@ static gpointer restart_marker_thread_func(gpointer d) {
       if (!compute_mcu_start(osr, jp, current_file, current_mcu_start,
                              NULL, NULL, &tmp_err)) {
         //g_debug("restart_marker_thread_func compute_mcu_start failed");
+        _openslide_fclose(g_steal_pointer(&current_file));
         break;
       }
 
@@ -956,13 +1131,19 @@ static gpointer restart_marker_thread_func(gpointer d) {
       if (current_mcu_start >= jp->tile_count) {
 	current_mcu_start = 0;
 	current_jpeg++;
-	_openslide_fclose(g_steal_pointer(&current_file));
+	jpeg_file_put(jp->file, g_steal_pointer(&current_file));
       }
     } else {
       current_jpeg++;
     }
   }
 
+  // return the handle we were using, if any
+  if (current_file) {
+    jpeg_file_put(data->all_jpegs[current_jpeg]->file,
+                  g_steal_pointer(&current_file));
+  }
+
   // store error, if any
   if (tmp_err) {
     //g_debug("restart_marker_thread_func failed: %s", tmp_err->message);
@@ -998,6 +1179,13 @@ static bool validate_jpeg_header(struct _openslide_file *f,
   if (!find_bitstream_start(f, sof_position, header_stop_position, err)) {
     return false;
   }
+  g_autofree uint8_t *header = read_jpeg_header(f, header_start,
+                                                *sof_position,
+                                                *header_stop_position,
+                                                err);
+  if (!header) {
+    return false;
+  }
 
   struct jpeg_decompress_struct *cinfo;
   g_auto(_openslide_jpeg_decompress) dc =
@@ -1006,8 +1194,10 @@ static bool validate_jpeg_header(struct _openslide_file *f,
   if (setjmp(env) == 0) {
     _openslide_jpeg_decompress_init(dc, &env);
     if (!jpeg_random_access_src(cinfo, f,
-                                header_start, *sof_position,
-                                *header_stop_position, -1, -1, err)) {
+                                header,
+                                *header_stop_position - header_start,
+                                *header_stop_position,
+                                -1, -1, err)) {
       return false;
     }
 
@@ -1275,6 +1465,19 @@ static bool init_jpeg_ops(openslide_t *_osr,
     g_ptr_array_free(g_steal_pointer(&setup->jpegs), false);
   osr->data = data;
 
+  // share a handle pool among JPEGs stored in the same file
+  data->jpeg_files =
+    g_hash_table_new_full(g_str_hash, g_str_equal,
+                          NULL, (GDestroyNotify) jpeg_file_free);
+  for (int32_t i = 0; i < data->jpeg_count; i++) {
+    struct jpeg *jp = data->all_jpegs[i];
+    jp->file = g_hash_table_lookup(data->jpeg_files, jp->filename);
+    if (!jp->file) {
+      jp->file = jpeg_file_new(jp->filename);
+      g_hash_table_insert(data->jpeg_files, jp->file->filename, jp->file);
+    }
+  }
+
   // create scale_denom levels
   create_scaled_jpeg_levels(osr, setup->levels);
 
@@ -1289,6 +1492,7 @@ static bool init_jpeg_ops(openslide_t *_osr,
   g_mutex_init(&data->restart_marker_mutex);
   g_cond_init(&data->restart_marker_cond);
   g_mutex_init(&data->restart_marker_cond_mutex);
+  g_mutex_init(&data->header_lock);
   data->restart_marker_thread_throttle =
     !_openslide_debug(OPENSLIDE_DEBUG_JPEG_MARKERS);
   if (background_thread) {
@@ -1612,9 +1816,20 @@ static bool ngr_paint_region(openslide_t *osr G_GNUC_UNUSED, cairo_t *cr,
                                       err);
 }
 
+static uint64_t ngr_get_memory_usage(openslide_t *osr) {
+  uint64_t total = 0;
+  for (int32_t i = 0; i < osr->level_count; i++) {
+    struct ngr_level *l = (struct ngr_level *) osr->levels[i];
+    total += sizeof(*l) + strlen(l->filename) + 1 +
+             _openslide_grid_get_memory_usage(l->grid, 0);
+  }
+  return total;
+}
+
 static const struct _openslide_ops ngr_ops = {
   .paint_region = ngr_paint_region,
   .destroy = ngr_destroy,
+  .get_memory_usage = ngr_get_memory_usage,
 };
 
 static int32_t read_le_int32_from_file(struct _openslide_file *f) {
@@ -201,20 +201,30 @@ static bool paint_region(openslide_t *osr, cairo_t *cr,
   struct leica_ops_data *data = osr->data;
   struct level *l = (struct level *) level;
 
-  g_auto(_openslide_cached_tiff) ct = _openslide_tiffcache_get(data->tc, err);
-  if (ct.tiff == NULL) {
-    return false;
-  }
-
+  g_auto(_openslide_cached_tiff) ct = {0};
   for (uint32_t n = 0; n < l->areas->len; n++) {
     struct area *area = l->areas->pdata[n];
 
+    // skip areas outside the region; most regions touch only a few
+    int64_t ax = x / l->base.downsample - area->offset_x;
+    int64_t ay = y / l->base.downsample - area->offset_y;
+    if (ax >= area->tiffl.image_w || ay >= area->tiffl.image_h ||
+        ax + w <= 0 || ay + h <= 0) {
+      continue;
+    }
+
+    // don't take a TIFF handle until we know we need one
+    if (ct.tiff == NULL) {
+      ct = _openslide_tiffcache_get(data->tc, err);
+      if (ct.tiff == NULL) {
+        return false;
+      }
+    }
+
     struct read_tile_args args = {
       .tiff = ct.tiff,
       .area = area,
     };
-    int64_t ax = x / l->base.downsample - area->offset_x;
-    int64_t ay = y / l->base.downsample - area->offset_y;
     if (!_openslide_grid_paint_region(area->grid, cr, &args,
                                       ax, ay, level, w, h,
                                       err)) {
@@ -225,9 +235,26 @@ static bool paint_region(openslide_t *osr, cairo_t *cr,
   return true;
 }
 
+static uint64_t get_memory_usage(openslide_t *osr) {
+  struct leica_ops_data *data = osr->data;
+  uint64_t total = sizeof(*data) +
+    _openslide_tiffcache_get_memory_usage(data->tc);
+  for (int32_t i = 0; i < osr->level_count; i++) {
+    struct level *l = (struct level *) osr->levels[i];
+    total += sizeof(*l) + l->areas->len * sizeof(void *);
+    for (guint n = 0; n < l->areas->len; n++) {
+      struct area *area = l->areas->pdata[n];
+      total += sizeof(*area) +
+        _openslide_grid_get_memory_usage(area->grid, 0);
+    }
+  }
+  return total;
+}
+
 static const struct _openslide_ops leica_ops = {
   .paint_region = paint_region,
   .destroy = destroy,
+  .get_memory_usage = get_memory_usage,
 };
 
 static bool leica_detect(const char *filename G_GNUC_UNUSED,
@@ -261,20 +288,37 @@ static bool leica_detect(const char *filename G_GNUC_UNUSED,
     return false;
   }
 
-  // try to parse the xml
-  g_autoptr(xmlDoc) doc = _openslide_xml_parse(image_desc, err);
-  if (doc == NULL) {
+  // check the root tag without building a tree
+  g_autoptr(xmlTextReader) reader = _openslide_xml_reader_create(image_desc,
+                                                                 err);
+  if (reader == NULL) {
+    return false;
+  }
+  g_autoptr(GError) tmp_err = NULL;
+  if (_openslide_xml_reader_next_element(reader, 0, &tmp_err) != 0) {
+    if (tmp_err) {
+      g_propagate_error(err, g_steal_pointer(&tmp_err));
+    } else {
+      g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                  "No root tag");
+    }
     return false;
   }
 
   // check default namespace
-  if (!_openslide_xml_has_default_namespace(doc, LEICA_XMLNS_1) &&
-      !_openslide_xml_has_default_namespace(doc, LEICA_XMLNS_2)) {
+  const xmlChar *ns = xmlTextReaderConstNamespaceUri(reader);
+  if (!ns || (xmlStrcmp(ns, BAD_CAST LEICA_XMLNS_1) &&
+              xmlStrcmp(ns, BAD_CAST LEICA_XMLNS_2))) {
     g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
                 "Unexpected XML namespace");
     return false;
   }
 
+  // malformed documents fall through to generic TIFF
+  if (!_openslide_xml_reader_check_rest(reader, err)) {
+    return false;
+  }
+
   return true;
 }
 
@@ -359,7 +403,7 @@ static void set_region_bounds_props(openslide_t *osr,
 
 static struct collection *parse_xml_description(const char *xml,
                                                 GError **err) {
-  // parse the xml
+  // parse the xml.  The document is small, so streaming wouldn't help.
   g_autoptr(xmlDoc) doc = _openslide_xml_parse(xml, err);
   if (doc == NULL) {
     return NULL;
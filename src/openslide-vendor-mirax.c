@@ -198,6 +198,12 @@ struct level {
 
 struct mirax_ops_data {
   gchar **datafile_paths;
+
+  // images currently being decoded by some thread; several tiles can
+  // share one image, and we only want to decode it once
+  GMutex decode_lock;
+  GCond decode_cond;
+  GHashTable *decoding;  // struct image * -> NULL
 };
 
 static void image_unref(struct image *image) {
@@ -255,6 +261,66 @@ static uint32_t *read_image(openslide_t *osr,
   return g_steal_pointer(&dest);
 }
 
+// get the image data, possibly from cache.  if another thread is already
+// decoding this image, wait for it to finish rather than decoding it again.
+static uint32_t *get_image(openslide_t *osr,
+                           struct level *l,
+                           struct image *image,
+                           struct _openslide_cache_entry **cache_entry,
+                           GError **err) {
+  struct mirax_ops_data *data = osr->data;
+  int iw = l->image_width;
+  int ih = l->image_height;
+
+  // fast path
+  uint32_t *imagedata = _openslide_cache_get(osr->cache,
+                                             l, image->imageno, 0,
+                                             cache_entry);
+  if (imagedata) {
+    return imagedata;
+  }
+
+  // claim the image, or wait for the thread that already has
+  {
+    g_autoptr(GMutexLocker) locker G_GNUC_UNUSED =
+      g_mutex_locker_new(&data->decode_lock);
+    while (true) {
+      // recheck under the lock, in case the decode finished in the
+      // meantime.  The fast path already counted this lookup as a miss.
+      imagedata = _openslide_cache_recheck(osr->cache,
+                                           l, image->imageno, 0,
+                                           cache_entry);
+      if (imagedata) {
+        return imagedata;
+      }
+      if (!g_hash_table_contains(data->decoding, image)) {
+        g_hash_table_add(data->decoding, image);
+        break;
+      }
+      // if the image didn't make it into the cache (error, or too large
+      // to cache), we'll end up claiming it ourselves
+      g_cond_wait(&data->decode_cond, &data->decode_lock);
+    }
+  }
+
+  imagedata = read_image(osr, image, l->image_format, iw, ih, err);
+  if (imagedata) {
+    _openslide_cache_put(osr->cache,
+                         l, image->imageno, 0,
+                         imagedata,
+                         iw * ih * 4,
+                         cache_entry);
+  }
+
+  // release the image and wake any waiters
+  g_mutex_lock(&data->decode_lock);
+  g_hash_table_remove(data->decoding, image);
+  g_cond_broadcast(&data->decode_cond);
+  g_mutex_unlock(&data->decode_lock);
+
+  return imagedata;
+}
+
 static bool read_tile(openslide_t *osr,
                       cairo_t *cr,
                       struct _openslide_level *level,
@@ -265,65 +331,84 @@ static bool read_tile(openslide_t *osr,
                       GError **err) {
   struct level *l = (struct level *) level;
   struct tile *tile = data;
-  bool success = true;
 
   int iw = l->image_width;
   int ih = l->image_height;
 
   //g_debug("mirax read_tile: src: %g %g, dim: %d %d, tile dim: %g %g, region %g %g %g %g", tile->src_x, tile->src_y, l->image_width, l->image_height, l->tile_w, l->tile_h, x, y, w, h);
 
-  // get the image data, possibly from cache
-  g_autoptr(_openslide_cache_entry) cache_entry = NULL;
-  uint32_t *tiledata = _openslide_cache_get(osr->cache,
-                                            level,
-                                            tile->image->imageno,
-                                            0,
-                                            &cache_entry);
+  // if the tile is the whole image, draw the image directly
+  if ((l->image_width <= l->tile_w) &&
+      (l->image_height <= l->tile_h)) {
+    g_autoptr(_openslide_cache_entry) cache_entry = NULL;
+    uint32_t *imagedata = get_image(osr, l, tile->image, &cache_entry, err);
+    if (!imagedata) {
+      return false;
+    }
 
+    g_autoptr(cairo_surface_t) surface =
+      cairo_image_surface_create_for_data((unsigned char *) imagedata,
+                                          CAIRO_FORMAT_RGB24,
+                                          iw, ih, iw * 4);
+    cairo_set_source_surface(cr, surface, 0, 0);
+    cairo_paint(cr);
+    return true;
+  }
+
+  // we are drawing a subregion of the image.  lower levels split one
+  // image into many tiles, so cache the extracted subregion separately
+  // to avoid repeating the copy for every read.  the tile struct is
+  // unique to this tile, so use it as the cache plane.
+  int tw = ceil(l->tile_w);
+  int th = ceil(l->tile_h);
+  g_autoptr(_openslide_cache_entry) tile_cache_entry = NULL;
+  uint32_t *tiledata = _openslide_cache_get(osr->cache,
+                                            tile, 0, 0,
+                                            &tile_cache_entry);
   if (!tiledata) {
-    tiledata = read_image(osr, tile->image, l->image_format, iw, ih, err);
-    if (tiledata == NULL) {
+    g_autoptr(_openslide_cache_entry) cache_entry = NULL;
+    uint32_t *imagedata = get_image(osr, l, tile->image, &cache_entry, err);
+    if (!imagedata) {
       return false;
     }
 
+    // we must do an additional copy, because cairo lacks source clipping
+    g_autofree uint32_t *buf = g_malloc0(tw * th * 4);
+    {
+      g_autoptr(cairo_surface_t) surface =
+        cairo_image_surface_create_for_data((unsigned char *) imagedata,
+                                            CAIRO_FORMAT_RGB24,
+                                            iw, ih, iw * 4);
+      g_autoptr(cairo_surface_t) surface2 =
+        cairo_image_surface_create_for_data((unsigned char *) buf,
+                                            CAIRO_FORMAT_ARGB32,
+                                            tw, th, tw * 4);
+      g_autoptr(cairo_t) cr2 = cairo_create(surface2);
+      cairo_set_source_surface(cr2, surface, -tile->src_x, -tile->src_y);
+      cairo_rectangle(cr2, 0, 0, tw, th);
+      cairo_fill(cr2);
+      if (!_openslide_check_cairo_status(cr2, err)) {
+        return false;
+      }
+    }
+
+    tiledata = g_steal_pointer(&buf);
     _openslide_cache_put(osr->cache,
-                         level, tile->image->imageno, 0,
+                         tile, 0, 0,
                          tiledata,
-                         iw * ih * 4,
-                         &cache_entry);
+                         tw * th * 4,
+                         &tile_cache_entry);
   }
 
   // draw it
   g_autoptr(cairo_surface_t) surface =
     cairo_image_surface_create_for_data((unsigned char *) tiledata,
-                                        CAIRO_FORMAT_RGB24,
-                                        iw, ih, iw * 4);
-
-  // if we are drawing a subregion of the tile, we must do an additional copy,
-  // because cairo lacks source clipping
-  if ((l->image_width > l->tile_w) ||
-      (l->image_height > l->tile_h)) {
-    cairo_surface_t *surface2 = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
-                                                           ceil(l->tile_w),
-                                                           ceil(l->tile_h));
-    g_autoptr(cairo_t) cr2 = cairo_create(surface2);
-    cairo_set_source_surface(cr2, surface, -tile->src_x, -tile->src_y);
-
-    // replace original image surface
-    cairo_surface_destroy(surface);
-    surface = surface2;
-
-    cairo_rectangle(cr2, 0, 0,
-                    ceil(l->tile_w),
-                    ceil(l->tile_h));
-    cairo_fill(cr2);
-    success = _openslide_check_cairo_status(cr2, err);
-  }
-
+                                        CAIRO_FORMAT_ARGB32,
+                                        tw, th, tw * 4);
   cairo_set_source_surface(cr, surface, 0, 0);
   cairo_paint(cr);
 
-  return success;
+  return true;
 }
 
 static bool paint_region(openslide_t *osr G_GNUC_UNUSED, cairo_t *cr,
@@ -356,12 +441,32 @@ static void destroy(openslide_t *osr) {
 
   // the ops data
   g_strfreev(data->datafile_paths);
+  g_hash_table_destroy(data->decoding);
+  g_cond_clear(&data->decode_cond);
+  g_mutex_clear(&data->decode_lock);
   g_free(data);
 }
 
+static uint64_t get_memory_usage(openslide_t *osr) {
+  struct mirax_ops_data *data = osr->data;
+  uint64_t total = sizeof(*data);
+  for (gchar **path = data->datafile_paths; *path; path++) {
+    total += sizeof(*path) + strlen(*path) + 1;
+  }
+  // images are shared between tiles, so charge each tile for one
+  for (int32_t i = 0; i < osr->level_count; i++) {
+    struct level *l = (struct level *) osr->levels[i];
+    total += sizeof(*l) +
+      _openslide_grid_get_memory_usage(l->grid, sizeof(struct tile) +
+                                                sizeof(struct image));
+  }
+  return total;
+}
+
 static const struct _openslide_ops mirax_ops = {
   .paint_region = paint_region,
   .destroy = destroy,
+  .get_memory_usage = get_memory_usage,
 };
 
 static bool mirax_detect(const char *filename, struct _openslide_tifflike *tl,
@@ -1855,6 +1960,9 @@ static bool mirax_open(openslide_t *osr, const char *filename,
   g_assert(osr->data == NULL);
   struct mirax_ops_data *data = g_new0(struct mirax_ops_data, 1);
   data->datafile_paths = g_steal_pointer(&datafile_paths);
+  g_mutex_init(&data->decode_lock);
+  g_cond_init(&data->decode_cond);
+  data->decoding = g_hash_table_new(g_direct_hash, g_direct_equal);
   osr->data = data;
 
   // set ops
@@ -73,8 +73,10 @@ struct level {
 
 struct xml_associated_image {
   struct _openslide_associated_image base;
-  struct _openslide_tiffcache *tc;
-  const char *xpath;  // static string; do not free
+  // compressed image data extracted from the XML at open time, so reads
+  // don't have to reparse the ImageDescription
+  void *data;
+  gsize len;
 };
 
 static void destroy_level(struct level *l) {
@@ -179,9 +181,22 @@ static bool paint_region(openslide_t *osr, cairo_t *cr,
                                       err);
 }
 
+static uint64_t get_memory_usage(openslide_t *osr) {
+  struct philips_tiff_ops_data *data = osr->data;
+  uint64_t total = sizeof(*data) +
+    _openslide_tiffcache_get_memory_usage(data->tc);
+  for (int32_t i = 0; i < osr->level_count; i++) {
+    struct level *l = (struct level *) osr->levels[i];
+    total += sizeof(*l) +
+      _openslide_grid_get_memory_usage(l->grid, 0);
+  }
+  return total;
+}
+
 static const struct _openslide_ops philips_tiff_ops = {
   .paint_region = paint_region,
   .destroy = destroy,
+  .get_memory_usage = get_memory_usage,
 };
 
 static bool philips_tiff_detect(const char *filename G_GNUC_UNUSED,
@@ -214,28 +229,46 @@ static bool philips_tiff_detect(const char *filename G_GNUC_UNUSED,
     return false;
   }
 
-  // try to parse the XML
-  g_autoptr(xmlDoc) doc = _openslide_xml_parse(image_desc, err);
-  if (doc == NULL) {
+  // check the root tag without building a tree; the rest of the document
+  // includes base64 associated images and is only checked for
+  // well-formedness here
+  g_autoptr(xmlTextReader) reader = _openslide_xml_reader_create(image_desc,
+                                                                 err);
+  if (reader == NULL) {
+    return false;
+  }
+  g_autoptr(GError) tmp_err = NULL;
+  if (_openslide_xml_reader_next_element(reader, 0, &tmp_err) != 0) {
+    if (tmp_err) {
+      g_propagate_error(err, g_steal_pointer(&tmp_err));
+    } else {
+      g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                  "No root tag");
+    }
     return false;
   }
 
   // check root tag name
-  xmlNode *root = xmlDocGetRootElement(doc);
-  if (xmlStrcmp(root->name, BAD_CAST XML_ROOT)) {
+  if (xmlStrcmp(xmlTextReaderConstLocalName(reader), BAD_CAST XML_ROOT)) {
     g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
                 "Root tag not %s", XML_ROOT);
     return false;
   }
 
   // check root tag type
-  g_autoptr(xmlChar) type = xmlGetProp(root, BAD_CAST XML_ROOT_TYPE_ATTR);
+  g_autoptr(xmlChar) type =
+    xmlTextReaderGetAttribute(reader, BAD_CAST XML_ROOT_TYPE_ATTR);
   if (!type || xmlStrcmp(type, BAD_CAST XML_ROOT_TYPE_VALUE)) {
     g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
                 "Root %s not \"%s\"", XML_ROOT_TYPE_ATTR, XML_ROOT_TYPE_VALUE);
     return false;
   }
 
+  // malformed documents fall through to generic TIFF
+  if (!_openslide_xml_reader_check_rest(reader, err)) {
+    return false;
+  }
+
   return true;
 }
 
@@ -249,6 +282,9 @@ static xmlDoc *parse_xml(TIFF *tiff, GError **err) {
     _openslide_tiff_error(err, tiff, "Couldn't read ImageDescription");
     return NULL;
   }
+  // Most of the document is base64 associated images, which we need.  The
+  // tree builder handles those large text nodes faster and in less memory
+  // than the streaming reader, so don't stream here.
   return _openslide_xml_parse(image_desc, err);
 }
 
@@ -273,30 +309,14 @@ static bool get_xml_associated_image_data(struct _openslide_associated_image *_i
                                           GError **err) {
   struct xml_associated_image *img = (struct xml_associated_image *) _img;
 
-  g_auto(_openslide_cached_tiff) ct = _openslide_tiffcache_get(img->tc, err);
-  if (!ct.tiff) {
-    return false;
-  }
-
-  g_autoptr(xmlDoc) doc = parse_xml(ct.tiff, err);
-  if (!doc) {
-    return false;
-  }
-
-  g_autofree void *data = NULL;
-  gsize len;
-  if (!get_compressed_xml_associated_image_data(doc, img->xpath,
-                                                &data, &len, err)) {
-    return false;
-  }
-
-  return _openslide_jpeg_decode_buffer(data, len, dest,
+  return _openslide_jpeg_decode_buffer(img->data, img->len, dest,
                                        img->base.w, img->base.h, err);
 }
 
 static void destroy_xml_associated_image(struct _openslide_associated_image *_img) {
   struct xml_associated_image *img = (struct xml_associated_image *) _img;
 
+  g_free(img->data);
   g_free(img);
 }
 
@@ -305,9 +325,7 @@ static const struct _openslide_associated_image_ops philips_tiff_xml_associated_
   .destroy = destroy_xml_associated_image,
 };
 
-// xpath is not copied (must be a static string)
 static bool maybe_add_xml_associated_image(openslide_t *osr,
-                                           struct _openslide_tiffcache *tc,
                                            xmlDoc *doc,
                                            const char *name,
                                            const char *xpath,
@@ -336,8 +354,8 @@ static bool maybe_add_xml_associated_image(openslide_t *osr,
   img->base.ops = &philips_tiff_xml_associated_ops;
   img->base.w = w;
   img->base.h = h;
-  img->tc = tc;
-  img->xpath = xpath;
+  img->data = g_steal_pointer(&data);
+  img->len = len;
 
   g_hash_table_insert(osr->associated_images, g_strdup(name), img);
 
@@ -678,9 +696,9 @@ static bool philips_tiff_open(openslide_t *osr,
 
   // add associated images from XML
   // errors are non-fatal
-  maybe_add_xml_associated_image(osr, tc, doc,
+  maybe_add_xml_associated_image(osr, doc,
                                  "label", LABEL_DATA_XPATH, NULL);
-  maybe_add_xml_associated_image(osr, tc, doc,
+  maybe_add_xml_associated_image(osr, doc,
                                  "macro", MACRO_DATA_XPATH, NULL);
 
   // allocate private data
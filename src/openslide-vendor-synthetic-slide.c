@@ -0,0 +1,902 @@
+/*
+ *  OpenSlide, a library for reading whole slide image files
+ *
+ *  Copyright (c) 2026 OpenSlide contributors
+ *  All rights reserved.
+ *
+ *  OpenSlide is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation, version 2.1.
+ *
+ *  OpenSlide is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with OpenSlide. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Parameterized synthetic slides, for benchmarking without slide files.
+ *
+ * The filename is a spec such as
+ *   synthetic://w=100000,h=80000,tile=512,codec=jpeg,levels=6,grid=simple
+ * A handful of procedurally generated tiles are encoded with the requested
+ * codec at open, and every tile of every level decodes one of them.  grid
+ * selects which grid implementation places the tiles.
+ * Requires OPENSLIDE_DEBUG=synthetic.  Codecs other than "none" need the
+ * tile encoders, which are built along with the tests.
+ *
+ * quickhash is the hash of the normalized spec.
+ *
+ */
+
+#include <config.h>
+
+#ifdef HAVE_SYNTHETIC_CODECS
+// libpng < 1.5 breaks the build if setjmp.h is included before png.h
+#include <png.h>
+#endif
+
+#include "openslide-private.h"
+#include "openslide-decode-jp2k.h"
+#include "openslide-decode-jpeg.h"
+#include "openslide-decode-png.h"
+
+#include <glib.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef HAVE_SYNTHETIC_CODECS
+#include <setjmp.h>
+#include <jpeglib.h>
+#include <jerror.h>
+#include <openjpeg.h>
+#include <zstd.h>
+#endif
+
+#define SPEC_PREFIX "synthetic://"
+#define VARIANTS 8
+#define MAX_TILE_SIZE 4096
+#define MAX_LEVELS 32
+#define MAX_GRID_TILES (1 << 20)
+#define JPEG_QUALITY 85
+#define J2K_RATE 10
+#define ZSTD_LEVEL 3
+#define BLOBS 12
+
+enum codec {
+  CODEC_NONE,
+  CODEC_JPEG,
+  CODEC_PNG,
+  CODEC_J2K,
+  CODEC_ZSTD,
+};
+
+static const char *const codec_names[] = {
+  [CODEC_NONE] = "none",
+  [CODEC_JPEG] = "jpeg",
+  [CODEC_PNG] = "png",
+  [CODEC_J2K] = "j2k",
+  [CODEC_ZSTD] = "zstd",
+};
+
+enum grid_type {
+  GRID_SIMPLE,
+  GRID_TILEMAP,
+  GRID_RANGE,
+};
+
+static const char *const grid_names[] = {
+  [GRID_SIMPLE] = "simple",
+  [GRID_TILEMAP] = "tilemap",
+  [GRID_RANGE] = "range",
+};
+
+struct spec {
+  int64_t w;
+  int64_t h;
+  int64_t tile;
+  int64_t levels;
+  enum codec codec;
+  enum grid_type grid;
+};
+
+struct variant {
+  void *data;
+  uint32_t len;
+};
+
+struct synthetic_slide_ops_data {
+  struct spec spec;
+  struct variant variants[VARIANTS];
+};
+
+struct level {
+  struct _openslide_level base;
+  struct _openslide_grid *grid;
+  int32_t index;
+  int64_t tiles_across;
+};
+
+#ifdef HAVE_SYNTHETIC_CODECS
+#define DEFAULT_CODEC CODEC_JPEG
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(opj_codec_t, opj_destroy_codec)
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(opj_image_t, opj_image_destroy)
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(opj_stream_t, opj_stream_destroy)
+#else
+#define DEFAULT_CODEC CODEC_NONE
+#endif
+
+static bool parse_name(const char *const *names, unsigned count,
+                       const char *value, int *out) {
+  for (unsigned i = 0; i < count; i++) {
+    if (g_str_equal(value, names[i])) {
+      *out = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool parse_spec(const char *filename, struct spec *spec,
+                       GError **err) {
+  if (!g_str_has_prefix(filename, SPEC_PREFIX)) {
+    g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                "Not a synthetic slide spec");
+    return false;
+  }
+
+  // defaults
+  *spec = (struct spec) {
+    .w = 100000,
+    .h = 80000,
+    .tile = 256,
+    .levels = 1,
+    .codec = DEFAULT_CODEC,
+    .grid = GRID_SIMPLE,
+  };
+
+  g_auto(GStrv) params = g_strsplit(filename + strlen(SPEC_PREFIX), ",", 0);
+  for (char **param = params; *param; param++) {
+    if (!**param) {
+      continue;
+    }
+    g_auto(GStrv) kv = g_strsplit(*param, "=", 2);
+    if (g_strv_length(kv) != 2) {
+      g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                  "Bad synthetic slide parameter: %s", *param);
+      return false;
+    }
+
+    int value;
+    if (g_str_equal(kv[0], "codec")) {
+      if (!parse_name(codec_names, G_N_ELEMENTS(codec_names),
+                      kv[1], &value)) {
+        g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                    "Unknown synthetic slide codec: %s", kv[1]);
+        return false;
+      }
+#ifndef HAVE_SYNTHETIC_CODECS
+      if (value != CODEC_NONE) {
+        g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                    "Synthetic slide codec %s not built", kv[1]);
+        return false;
+      }
+#endif
+      spec->codec = value;
+      continue;
+    } else if (g_str_equal(kv[0], "grid")) {
+      if (!parse_name(grid_names, G_N_ELEMENTS(grid_names),
+                      kv[1], &value)) {
+        g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                    "Unknown synthetic slide grid: %s", kv[1]);
+        return false;
+      }
+      spec->grid = value;
+      continue;
+    }
+
+    int64_t *out;
+    int64_t max;
+    if (g_str_equal(kv[0], "w")) {
+      out = &spec->w;
+      max = INT64_MAX / 2;
+    } else if (g_str_equal(kv[0], "h")) {
+      out = &spec->h;
+      max = INT64_MAX / 2;
+    } else if (g_str_equal(kv[0], "tile")) {
+      out = &spec->tile;
+      max = MAX_TILE_SIZE;
+    } else if (g_str_equal(kv[0], "levels")) {
+      out = &spec->levels;
+      max = MAX_LEVELS;
+    } else {
+      g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                  "Unknown synthetic slide parameter: %s", kv[0]);
+      return false;
+    }
+    if (!_openslide_parse_int64(kv[1], out) || *out < 1 || *out > max) {
+      g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                  "Invalid value for synthetic slide parameter %s: %s",
+                  kv[0], kv[1]);
+      return false;
+    }
+  }
+  return true;
+}
+
+// something vaguely like stained tissue, so the codecs have realistic work
+static void generate_tile(uint32_t *dest, int32_t size, uint32_t seed) {
+  g_autoptr(GRand) rand = g_rand_new_with_seed(seed);
+  struct {
+    int32_t x;
+    int32_t y;
+    int64_t r2;
+    uint8_t r, g, b;
+  } blobs[BLOBS];
+  for (int i = 0; i < BLOBS; i++) {
+    int32_t r = g_rand_int_range(rand, size / 32 + 1, size / 6 + 2);
+    blobs[i].x = g_rand_int_range(rand, 0, size);
+    blobs[i].y = g_rand_int_range(rand, 0, size);
+    blobs[i].r2 = (int64_t) r * r;
+    blobs[i].r = g_rand_int_range(rand, 120, 220);
+    blobs[i].g = g_rand_int_range(rand, 40, 120);
+    blobs[i].b = g_rand_int_range(rand, 120, 200);
+  }
+
+  for (int32_t y = 0; y < size; y++) {
+    for (int32_t x = 0; x < size; x++) {
+      uint8_t r = 240, g = 232, b = 240;
+      for (int i = 0; i < BLOBS; i++) {
+        int64_t dx = x - blobs[i].x;
+        int64_t dy = y - blobs[i].y;
+        if (dx * dx + dy * dy < blobs[i].r2) {
+          r = blobs[i].r;
+          g = blobs[i].g;
+          b = blobs[i].b;
+        }
+      }
+      int32_t noise = g_rand_int_range(rand, -8, 9);
+      r = CLAMP(r + noise, 0, 255);
+      g = CLAMP(g + noise, 0, 255);
+      b = CLAMP(b + noise, 0, 255);
+      dest[y * size + x] = 0xff000000 | r << 16 | g << 8 | b;
+    }
+  }
+}
+
+#ifdef HAVE_SYNTHETIC_CODECS
+static void argb_to_rgb(uint8_t *dest, const uint32_t *src, int32_t w) {
+  for (int32_t x = 0; x < w; x++) {
+    dest[3 * x] = (src[x] >> 16) & 0xff;
+    dest[3 * x + 1] = (src[x] >> 8) & 0xff;
+    dest[3 * x + 2] = src[x] & 0xff;
+  }
+}
+
+#define JPEG_DEST_CHUNK 16384
+
+struct jpeg_dest {
+  struct jpeg_destination_mgr pub;
+  GByteArray *out;
+  JOCTET chunk[JPEG_DEST_CHUNK];
+};
+
+static void jpeg_dest_init(j_compress_ptr cinfo) {
+  struct jpeg_dest *dest = (struct jpeg_dest *) cinfo->dest;
+  dest->pub.next_output_byte = dest->chunk;
+  dest->pub.free_in_buffer = JPEG_DEST_CHUNK;
+}
+
+static boolean jpeg_dest_empty(j_compress_ptr cinfo) {
+  struct jpeg_dest *dest = (struct jpeg_dest *) cinfo->dest;
+  g_byte_array_append(dest->out, dest->chunk, JPEG_DEST_CHUNK);
+  dest->pub.next_output_byte = dest->chunk;
+  dest->pub.free_in_buffer = JPEG_DEST_CHUNK;
+  return TRUE;
+}
+
+static void jpeg_dest_term(j_compress_ptr cinfo) {
+  struct jpeg_dest *dest = (struct jpeg_dest *) cinfo->dest;
+  g_byte_array_append(dest->out, dest->chunk,
+                      JPEG_DEST_CHUNK - dest->pub.free_in_buffer);
+}
+
+struct jpeg_encode_err {
+  struct jpeg_error_mgr pub;
+  jmp_buf env;
+};
+
+static void jpeg_encode_error_exit(j_common_ptr cinfo) {
+  struct jpeg_encode_err *jerr = (struct jpeg_encode_err *) cinfo->err;
+  longjmp(jerr->env, 1);
+}
+
+static bool encode_jpeg(const uint32_t *pixels, int32_t size,
+                        GByteArray *out, GError **err) {
+  struct jpeg_compress_struct cinfo;
+  struct jpeg_encode_err jerr;
+  struct jpeg_dest dest = {
+    .pub = {
+      .init_destination = jpeg_dest_init,
+      .empty_output_buffer = jpeg_dest_empty,
+      .term_destination = jpeg_dest_term,
+    },
+    .out = out,
+  };
+  g_autofree uint8_t *row = g_malloc(3 * size);
+
+  memset(&cinfo, 0, sizeof(cinfo));
+  cinfo.err = jpeg_std_error(&jerr.pub);
+  jerr.pub.error_exit = jpeg_encode_error_exit;
+  if (setjmp(jerr.env)) {
+    char msg[JMSG_LENGTH_MAX];
+    jerr.pub.format_message((j_common_ptr) &cinfo, msg);
+    g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                "Couldn't encode JPEG: %s", msg);
+    jpeg_destroy_compress(&cinfo);
+    return false;
+  }
+
+  jpeg_create_compress(&cinfo);
+  cinfo.dest = &dest.pub;
+  cinfo.image_width = size;
+  cinfo.image_height = size;
+  cinfo.input_components = 3;
+  cinfo.in_color_space = JCS_RGB;
+  jpeg_set_defaults(&cinfo);
+  jpeg_set_quality(&cinfo, JPEG_QUALITY, TRUE);
+  jpeg_start_compress(&cinfo, TRUE);
+  while (cinfo.next_scanline < cinfo.image_height) {
+    argb_to_rgb(row, pixels + (int64_t) cinfo.next_scanline * size, size);
+    JSAMPROW rows[] = {row};
+    jpeg_write_scanlines(&cinfo, rows, 1);
+  }
+  jpeg_finish_compress(&cinfo);
+  jpeg_destroy_compress(&cinfo);
+  return true;
+}
+
+struct png_encode_ctx {
+  jmp_buf env;
+  GError *err;
+};
+
+static void png_encode_error(png_struct *png, const char *message) {
+  struct png_encode_ctx *ctx = png_get_error_ptr(png);
+  g_set_error(&ctx->err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+              "PNG error: %s", message);
+  longjmp(ctx->env, 1);
+}
+
+static void png_encode_warning(png_struct *png G_GNUC_UNUSED,
+                               const char *message G_GNUC_UNUSED) {
+}
+
+static void png_encode_write(png_struct *png, png_byte *data,
+                             png_size_t len) {
+  g_byte_array_append(png_get_io_ptr(png), data, len);
+}
+
+static void png_encode_flush(png_struct *png G_GNUC_UNUSED) {
+}
+
+static bool encode_png(const uint32_t *pixels, int32_t size,
+                       GByteArray *out, GError **err) {
+  struct png_encode_ctx ctx = {0};
+  g_autofree uint8_t *row = g_malloc(3 * size);
+
+  png_struct *png = png_create_write_struct(PNG_LIBPNG_VER_STRING, &ctx,
+                                            png_encode_error,
+                                            png_encode_warning);
+  if (!png) {
+    g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                "Couldn't initialize libpng");
+    return false;
+  }
+  png_info *info = png_create_info_struct(png);
+  if (!info) {
+    png_destroy_write_struct(&png, NULL);
+    g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                "Couldn't initialize PNG info");
+    return false;
+  }
+  if (setjmp(ctx.env)) {
+    png_destroy_write_struct(&png, &info);
+    g_propagate_error(err, ctx.err);
+    return false;
+  }
+
+  png_set_write_fn(png, out, png_encode_write, png_encode_flush);
+  png_set_IHDR(png, info, size, size, 8, PNG_COLOR_TYPE_RGB,
+               PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT,
+               PNG_FILTER_TYPE_DEFAULT);
+  png_write_info(png, info);
+  for (int32_t y = 0; y < size; y++) {
+    argb_to_rgb(row, pixels + (int64_t) y * size, size);
+    png_write_row(png, row);
+  }
+  png_write_end(png, NULL);
+  png_destroy_write_struct(&png, &info);
+  return true;
+}
+
+struct j2k_encode_state {
+  GByteArray *out;
+  gsize pos;
+};
+
+static OPJ_SIZE_T j2k_encode_write(void *buf, OPJ_SIZE_T count, void *data) {
+  struct j2k_encode_state *state = data;
+  if (state->pos + count > state->out->len) {
+    g_byte_array_set_size(state->out, state->pos + count);
+  }
+  memcpy(state->out->data + state->pos, buf, count);
+  state->pos += count;
+  return count;
+}
+
+static OPJ_OFF_T j2k_encode_skip(OPJ_OFF_T count, void *data) {
+  struct j2k_encode_state *state = data;
+  if (count < 0 && (gsize) -count > state->pos) {
+    return -1;
+  }
+  state->pos += count;
+  return count;
+}
+
+static OPJ_BOOL j2k_encode_seek(OPJ_OFF_T offset, void *data) {
+  struct j2k_encode_state *state = data;
+  if (offset < 0) {
+    return OPJ_FALSE;
+  }
+  state->pos = offset;
+  return OPJ_TRUE;
+}
+
+static void j2k_encode_error(const char *msg, void *data) {
+  GError **err = data;
+  if (!*err) {
+    g_autofree char *detail = g_strdup(msg);
+    g_strchomp(detail);
+    g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                "OpenJPEG error: %s", detail);
+  }
+}
+
+static bool encode_j2k(const uint32_t *pixels, int32_t size,
+                       GByteArray *out, GError **err) {
+  opj_image_cmptparm_t comp_params[3];
+  memset(comp_params, 0, sizeof(comp_params));
+  for (int i = 0; i < 3; i++) {
+    comp_params[i].dx = 1;
+    comp_params[i].dy = 1;
+    comp_params[i].w = size;
+    comp_params[i].h = size;
+    comp_params[i].prec = 8;
+  }
+  g_autoptr(opj_image_t) image =
+    opj_image_create(3, comp_params, OPJ_CLRSPC_SRGB);
+  if (!image) {
+    g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                "Couldn't create JPEG 2000 image");
+    return false;
+  }
+  image->x1 = size;
+  image->y1 = size;
+  for (int64_t i = 0; i < (int64_t) size * size; i++) {
+    image->comps[0].data[i] = (pixels[i] >> 16) & 0xff;
+    image->comps[1].data[i] = (pixels[i] >> 8) & 0xff;
+    image->comps[2].data[i] = pixels[i] & 0xff;
+  }
+
+  opj_cparameters_t params;
+  opj_set_default_encoder_parameters(&params);
+  params.tcp_numlayers = 1;
+  params.tcp_rates[0] = J2K_RATE;
+  params.cp_disto_alloc = 1;
+  params.tcp_mct = 1;
+
+  GError *tmp_err = NULL;
+  g_autoptr(opj_codec_t) codec = opj_create_compress(OPJ_CODEC_J2K);
+  opj_set_error_handler(codec, j2k_encode_error, &tmp_err);
+  struct j2k_encode_state state = {
+    .out = out,
+  };
+  g_autoptr(opj_stream_t) stream =
+    opj_stream_create(OPJ_J2K_STREAM_CHUNK_SIZE, false);
+  opj_stream_set_user_data(stream, &state, NULL);
+  opj_stream_set_write_function(stream, j2k_encode_write);
+  opj_stream_set_skip_function(stream, j2k_encode_skip);
+  opj_stream_set_seek_function(stream, j2k_encode_seek);
+  if (!opj_setup_encoder(codec, &params, image) ||
+      !opj_start_compress(codec, image, stream) ||
+      !opj_encode(codec, stream) ||
+      !opj_end_compress(codec, stream)) {
+    if (tmp_err) {
+      g_propagate_error(err, tmp_err);
+    } else {
+      g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                  "Couldn't encode JPEG 2000 image");
+    }
+    return false;
+  }
+  return true;
+}
+
+static bool encode_zstd(const uint32_t *pixels, int32_t size,
+                        GByteArray *out, GError **err) {
+  size_t len = (size_t) size * size * 4;
+  g_byte_array_set_size(out, ZSTD_compressBound(len));
+  size_t rc = ZSTD_compress(out->data, out->len, pixels, len, ZSTD_LEVEL);
+  if (ZSTD_isError(rc)) {
+    g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                "zstd compression error: %s", ZSTD_getErrorName(rc));
+    return false;
+  }
+  g_byte_array_set_size(out, rc);
+  return true;
+}
+
+#endif
+
+static bool encode_variant(struct variant *variant, const struct spec *spec,
+                           uint32_t seed, GError **err) {
+  int32_t size = spec->tile;
+  g_autofree uint32_t *pixels = g_new(uint32_t, (int64_t) size * size);
+  generate_tile(pixels, size, seed);
+
+  g_autoptr(GByteArray) out = g_byte_array_new();
+  switch (spec->codec) {
+  case CODEC_NONE:
+    g_byte_array_append(out, (const guint8 *) pixels,
+                        (int64_t) size * size * 4);
+    break;
+#ifdef HAVE_SYNTHETIC_CODECS
+  case CODEC_JPEG:
+    if (!encode_jpeg(pixels, size, out, err)) {
+      return false;
+    }
+    break;
+  case CODEC_PNG:
+    if (!encode_png(pixels, size, out, err)) {
+      return false;
+    }
+    break;
+  case CODEC_J2K:
+    if (!encode_j2k(pixels, size, out, err)) {
+      return false;
+    }
+    break;
+  case CODEC_ZSTD:
+    if (!encode_zstd(pixels, size, out, err)) {
+      return false;
+    }
+    break;
+#endif
+  default:
+    g_assert_not_reached();
+  }
+
+  variant->len = out->len;
+  variant->data = g_byte_array_free(g_steal_pointer(&out), false);
+  return true;
+}
+
+static bool decode_variant(const struct variant *variant,
+                           const struct spec *spec,
+                           uint32_t *dest, GError **err) {
+  int32_t size = spec->tile;
+  switch (spec->codec) {
+  case CODEC_NONE:
+    memcpy(dest, variant->data, variant->len);
+    return true;
+  case CODEC_JPEG:
+    return _openslide_jpeg_decode_buffer(variant->data, variant->len,
+                                         dest, size, size, err);
+  case CODEC_PNG:
+    return _openslide_png_decode_buffer(variant->data, variant->len,
+                                        dest, size, size, err);
+  case CODEC_J2K:
+    return _openslide_jp2k_decode_buffer(dest, size, size,
+                                         variant->data, variant->len,
+                                         OPENSLIDE_JP2K_RGB, err);
+  case CODEC_ZSTD: {
+    int64_t len = (int64_t) size * size * 4;
+    g_autofree void *buf =
+      _openslide_zstd_decompress_buffer(variant->data, variant->len,
+                                        len, err);
+    if (!buf) {
+      return false;
+    }
+    memcpy(dest, buf, len);
+    return true;
+  }
+  }
+  g_assert_not_reached();
+  return false;
+}
+
+static void level_free(struct level *l) {
+  _openslide_grid_destroy(l->grid);
+  g_free(l);
+}
+
+static void destroy(openslide_t *osr) {
+  for (int32_t i = 0; i < osr->level_count; i++) {
+    level_free((struct level *) osr->levels[i]);
+  }
+  g_free(osr->levels);
+
+  struct synthetic_slide_ops_data *data = osr->data;
+  for (int i = 0; i < VARIANTS; i++) {
+    g_free(data->variants[i].data);
+  }
+  g_free(data);
+}
+
+static bool read_tile(openslide_t *osr,
+                      cairo_t *cr,
+                      struct _openslide_level *level,
+                      int64_t tile_col, int64_t tile_row,
+                      void *arg G_GNUC_UNUSED,
+                      GError **err) {
+  struct synthetic_slide_ops_data *data = osr->data;
+  struct level *l = (struct level *) level;
+  int64_t size = data->spec.tile;
+
+  // cache
+  g_autoptr(_openslide_cache_entry) cache_entry = NULL;
+  uint32_t *tiledata = _openslide_cache_get(osr->cache,
+                                            level, tile_col, tile_row,
+                                            &cache_entry);
+  if (!tiledata) {
+    // spread the variants around so neighboring tiles differ
+    uint32_t which = (tile_col * 7 + tile_row * 13 + l->index * 5) % VARIANTS;
+    g_autofree uint32_t *buf = g_malloc(size * size * 4);
+    if (!decode_variant(&data->variants[which], &data->spec, buf, err)) {
+      return false;
+    }
+
+    // clip, if necessary
+    if (!_openslide_clip_tile(buf, size, size,
+                              l->base.w - tile_col * size,
+                              l->base.h - tile_row * size,
+                              err)) {
+      return false;
+    }
+
+    // put it in the cache
+    tiledata = g_steal_pointer(&buf);
+    _openslide_cache_put(osr->cache, level, tile_col, tile_row,
+                         tiledata, size * size * 4,
+                         &cache_entry);
+  }
+
+  // draw it
+  g_autoptr(cairo_surface_t) surface =
+    cairo_image_surface_create_for_data((unsigned char *) tiledata,
+                                        CAIRO_FORMAT_ARGB32,
+                                        size, size, size * 4);
+  cairo_set_source_surface(cr, surface, 0, 0);
+  cairo_paint(cr);
+
+  return true;
+}
+
+static bool read_tile_tilemap(openslide_t *osr,
+                              cairo_t *cr,
+                              struct _openslide_level *level,
+                              int64_t tile_col, int64_t tile_row,
+                              void *tile G_GNUC_UNUSED,
+                              void *arg,
+                              GError **err) {
+  return read_tile(osr, cr, level, tile_col, tile_row, arg, err);
+}
+
+static bool read_tile_range(openslide_t *osr,
+                            cairo_t *cr,
+                            struct _openslide_level *level,
+                            int64_t tile_unique_id,
+                            void *tile G_GNUC_UNUSED,
+                            void *arg,
+                            GError **err) {
+  // tiles were added in row-major order
+  struct level *l = (struct level *) level;
+  return read_tile(osr, cr, level,
+                   tile_unique_id % l->tiles_across,
+                   tile_unique_id / l->tiles_across,
+                   arg, err);
+}
+
+// each level is half the size of the last
+static int64_t level_dimension(int64_t size, int32_t level) {
+  return MAX((size + ((int64_t) 1 << level) - 1) >> level, 1);
+}
+
+// tilemap and range grids store every tile, which happens at open
+static bool check_grid_tiles(const struct spec *spec, GError **err) {
+  if (spec->grid == GRID_SIMPLE) {
+    return true;
+  }
+  int64_t total = 0;
+  for (int32_t i = 0; i < spec->levels; i++) {
+    int64_t across = (level_dimension(spec->w, i) + spec->tile - 1) /
+                     spec->tile;
+    int64_t down = (level_dimension(spec->h, i) + spec->tile - 1) /
+                   spec->tile;
+    if (across > MAX_GRID_TILES || down > MAX_GRID_TILES ||
+        across * down > MAX_GRID_TILES - total) {
+      g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                  "Synthetic slide with %s grid has more than %d tiles",
+                  grid_names[spec->grid], MAX_GRID_TILES);
+      return false;
+    }
+    total += across * down;
+  }
+  return true;
+}
+
+static struct _openslide_grid *create_grid(openslide_t *osr,
+                                           const struct spec *spec,
+                                           int64_t tiles_across,
+                                           int64_t tiles_down) {
+  int32_t size = spec->tile;
+  struct _openslide_grid *grid;
+  switch (spec->grid) {
+  case GRID_SIMPLE:
+    return _openslide_grid_create_simple(osr, tiles_across, tiles_down,
+                                         size, size, read_tile);
+  case GRID_TILEMAP:
+    grid = _openslide_grid_create_tilemap(osr, size, size,
+                                          read_tile_tilemap, NULL);
+    for (int64_t row = 0; row < tiles_down; row++) {
+      for (int64_t col = 0; col < tiles_across; col++) {
+        _openslide_grid_tilemap_add_tile(grid, col, row, 0, 0,
+                                         size, size, NULL);
+      }
+    }
+    return grid;
+  case GRID_RANGE:
+    grid = _openslide_grid_create_range(osr, size, size,
+                                        read_tile_range, NULL);
+    for (int64_t row = 0; row < tiles_down; row++) {
+      for (int64_t col = 0; col < tiles_across; col++) {
+        _openslide_grid_range_add_tile(grid, col * size, row * size, 0,
+                                       size, size, NULL);
+      }
+    }
+    _openslide_grid_range_finish_adding_tiles(grid);
+    return grid;
+  }
+  g_assert_not_reached();
+  return NULL;
+}
+
+static bool paint_region(openslide_t *osr G_GNUC_UNUSED, cairo_t *cr,
+                         int64_t x, int64_t y,
+                         struct _openslide_level *level,
+                         int32_t w, int32_t h,
+                         GError **err) {
+  struct level *l = (struct level *) level;
+  return _openslide_grid_paint_region(l->grid, cr, NULL,
+                                      x / l->base.downsample,
+                                      y / l->base.downsample,
+                                      level, w, h,
+                                      err);
+}
+
+static uint64_t get_memory_usage(openslide_t *osr) {
+  struct synthetic_slide_ops_data *data = osr->data;
+  uint64_t total = sizeof(*data);
+  for (int i = 0; i < VARIANTS; i++) {
+    total += data->variants[i].len;
+  }
+  for (int32_t i = 0; i < osr->level_count; i++) {
+    struct level *l = (struct level *) osr->levels[i];
+    total += sizeof(*l) + _openslide_grid_get_memory_usage(l->grid, 0);
+  }
+  return total;
+}
+
+static const struct _openslide_ops synthetic_slide_ops = {
+  .paint_region = paint_region,
+  .destroy = destroy,
+  .get_memory_usage = get_memory_usage,
+};
+
+static bool synthetic_slide_detect(const char *filename,
+                                   struct _openslide_tifflike *tl G_GNUC_UNUSED,
+                                   GError **err) {
+  if (!g_str_has_prefix(filename, SPEC_PREFIX)) {
+    g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                "Not a synthetic slide spec");
+    return false;
+  }
+
+  // require debug flag
+  if (!_openslide_debug(OPENSLIDE_DEBUG_SYNTHETIC)) {
+    g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                "synthetic debug flag is not set");
+    return false;
+  }
+
+  return true;
+}
+
+static bool synthetic_slide_open(openslide_t *osr,
+                                 const char *filename,
+                                 struct _openslide_tifflike *tl G_GNUC_UNUSED,
+                                 struct _openslide_hash *quickhash1,
+                                 GError **err) {
+  struct spec spec;
+  if (!parse_spec(filename, &spec, err) ||
+      !check_grid_tiles(&spec, err)) {
+    return false;
+  }
+
+  // encode tiles
+  struct synthetic_slide_ops_data *data =
+    g_new0(struct synthetic_slide_ops_data, 1);
+  data->spec = spec;
+  for (int i = 0; i < VARIANTS; i++) {
+    if (!encode_variant(&data->variants[i], &spec, i, err)) {
+      for (int j = 0; j < i; j++) {
+        g_free(data->variants[j].data);
+      }
+      g_free(data);
+      return false;
+    }
+  }
+
+  // create levels
+  g_autoptr(GPtrArray) level_array =
+    g_ptr_array_new_with_free_func((GDestroyNotify) level_free);
+  for (int32_t i = 0; i < spec.levels; i++) {
+    struct level *l = g_new0(struct level, 1);
+    g_ptr_array_add(level_array, l);
+    l->index = i;
+    l->base.downsample = (double) ((int64_t) 1 << i);
+    l->base.w = level_dimension(spec.w, i);
+    l->base.h = level_dimension(spec.h, i);
+    l->base.tile_w = spec.tile;
+    l->base.tile_h = spec.tile;
+    l->tiles_across = (l->base.w + spec.tile - 1) / spec.tile;
+    l->grid = create_grid(osr, &spec, l->tiles_across,
+                          (l->base.h + spec.tile - 1) / spec.tile);
+  }
+
+  // properties
+  g_autofree char *normalized =
+    g_strdup_printf("w=%"PRId64",h=%"PRId64",tile=%"PRId64","
+                    "codec=%s,levels=%"PRId64",grid=%s",
+                    spec.w, spec.h, spec.tile,
+                    codec_names[spec.codec], spec.levels,
+                    grid_names[spec.grid]);
+  g_hash_table_insert(osr->properties,
+                      g_strdup("synthetic.spec"),
+                      g_strdup(normalized));
+  _openslide_hash_string(quickhash1, normalized);
+
+  // store osr data
+  g_assert(osr->data == NULL);
+  g_assert(osr->levels == NULL);
+  osr->level_count = level_array->len;
+  osr->levels = (struct _openslide_level **)
+    g_ptr_array_free(g_steal_pointer(&level_array), false);
+  osr->data = data;
+  osr->ops = &synthetic_slide_ops;
+
+  return true;
+}
+
+const struct _openslide_format _openslide_format_synthetic_slide = {
+  .name = "synthetic-slide",
+  .vendor = "synthetic",
+  .detect = synthetic_slide_detect,
+  .open = synthetic_slide_open,
+};
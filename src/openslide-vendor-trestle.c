@@ -49,6 +49,8 @@ struct level {
   struct _openslide_level base;
   struct _openslide_tiff_level tiffl;
   struct _openslide_grid *grid;
+  int32_t overlap_x;
+  int32_t overlap_y;
 };
 
 static void destroy_level(struct level *l) {
@@ -109,15 +111,29 @@ static bool read_tile(openslide_t *osr,
                          &cache_entry);
   }
 
-  // draw it
+  // Draw it.  Each tile is cropped to the part not covered by its
+  // right/bottom neighbor, so tiles don't overlap and can be copied with
+  // SOURCE rather than blended.
+  int64_t crop_w = tw;
+  int64_t crop_h = th;
+  if (tile_col < tiffl->tiles_across - 1) {
+    crop_w -= l->overlap_x;
+  }
+  if (tile_row < tiffl->tiles_down - 1) {
+    crop_h -= l->overlap_y;
+  }
   g_autoptr(cairo_surface_t) surface =
     cairo_image_surface_create_for_data((unsigned char *) tiledata,
                                         CAIRO_FORMAT_ARGB32,
                                         tw, th, tw * 4);
+  cairo_save(cr);
+  cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
   cairo_set_source_surface(cr, surface, 0, 0);
-  cairo_paint(cr);
+  cairo_rectangle(cr, 0, 0, crop_w, crop_h);
+  cairo_fill(cr);
+  cairo_restore(cr);
 
-  return true;
+  return _openslide_check_cairo_status(cr, err);
 }
 
 static bool paint_region(openslide_t *osr, cairo_t *cr,
@@ -140,9 +156,22 @@ static bool paint_region(openslide_t *osr, cairo_t *cr,
                                       err);
 }
 
+static uint64_t get_memory_usage(openslide_t *osr) {
+  struct trestle_ops_data *data = osr->data;
+  uint64_t total = sizeof(*data) +
+    _openslide_tiffcache_get_memory_usage(data->tc);
+  for (int32_t i = 0; i < osr->level_count; i++) {
+    struct level *l = (struct level *) osr->levels[i];
+    total += sizeof(*l) +
+      _openslide_grid_get_memory_usage(l->grid, 0);
+  }
+  return total;
+}
+
 static const struct _openslide_ops trestle_ops = {
   .paint_region = paint_region,
   .destroy = destroy,
+  .get_memory_usage = get_memory_usage,
 };
 
 static bool trestle_detect(const char *filename G_GNUC_UNUSED,
@@ -327,6 +356,8 @@ static bool trestle_open(openslide_t *osr, const char *filename,
         report_geometry = false;
       }
     }
+    l->overlap_x = overlap_x;
+    l->overlap_y = overlap_y;
 
     // subtract out the overlaps (there are tiles-1 overlaps in each dimension)
     if (tiffl->image_w >= tiffl->tile_w) {
@@ -342,13 +373,21 @@ static bool trestle_open(openslide_t *osr, const char *filename,
                                              tiffl->tile_h - overlap_y,
                                              read_tile, NULL);
 
-    // add tiles
+    // add tiles, cropped to their integer non-overlapping extents
     for (int64_t y = 0; y < tiffl->tiles_down; y++) {
+      int64_t h = tiffl->tile_h;
+      if (y < tiffl->tiles_down - 1) {
+        h -= overlap_y;
+      }
       for (int64_t x = 0; x < tiffl->tiles_across; x++) {
+        int64_t w = tiffl->tile_w;
+        if (x < tiffl->tiles_across - 1) {
+          w -= overlap_x;
+        }
         _openslide_grid_tilemap_add_tile(l->grid,
                                          x, y,
                                          0, 0,
-                                         tiffl->tile_w, tiffl->tile_h,
+                                         w, h,
                                          NULL);
       }
     }
@@ -147,16 +147,22 @@ static void destroy(openslide_t *osr) {
   g_free(osr->levels);
 }
 
-static bool read_subtile(openslide_t *osr,
-                         cairo_t *cr,
-                         struct _openslide_level *level,
-                         int64_t subtile_col, int64_t subtile_row,
-                         void *arg,
-                         GError **err) {
+// crop rectangle of a BIF subtile, fixed at open so that overlapping
+// subtiles are placed on integer coordinates and painted once
+struct placement {
+  int32_t w;
+  int32_t h;
+};
+
+static bool paint_subtile(openslide_t *osr,
+                          cairo_t *cr,
+                          struct _openslide_level *level,
+                          int64_t subtile_col, int64_t subtile_row,
+                          int32_t crop_w, int32_t crop_h,
+                          TIFF *tiff,
+                          GError **err) {
   struct level *l = (struct level *) level;
   struct _openslide_tiff_level *tiffl = &l->tiffl;
-  TIFF *tiff = arg;
-  bool success = true;
 
   // tile size and coordinates
   int64_t tile_col = subtile_col / l->subtiles_per_tile;
@@ -164,7 +170,7 @@ static bool read_subtile(openslide_t *osr,
   int64_t tw = tiffl->tile_w;
   int64_t th = tiffl->tile_h;
 
-  // subtile offset and size
+  // subtile offset
   double subtile_w = (double) tw / l->subtiles_per_tile;
   double subtile_h = (double) th / l->subtiles_per_tile;
   double subtile_x = subtile_col % l->subtiles_per_tile * subtile_w;
@@ -197,50 +203,43 @@ static bool read_subtile(openslide_t *osr,
                          &cache_entry);
   }
 
-  // draw
+  // draw the crop rectangle of the subtile straight from the tile
   g_autoptr(cairo_surface_t) surface =
     cairo_image_surface_create_for_data((unsigned char *) tiledata,
                                         CAIRO_FORMAT_ARGB32,
                                         tw, th, tw * 4);
+  cairo_set_source_surface(cr, surface, -subtile_x, -subtile_y);
+  cairo_rectangle(cr, 0, 0, crop_w, crop_h);
+  cairo_fill(cr);
 
-  // if we are drawing a subtile, we must do an additional copy,
-  // because cairo lacks source clipping
-  if (l->subtiles_per_tile > 1) {
-    cairo_surface_t *surface2 = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
-                                                           ceil(subtile_w),
-                                                           ceil(subtile_h));
-    g_autoptr(cairo_t) cr2 = cairo_create(surface2);
-    cairo_set_source_surface(cr2, surface, -subtile_x, -subtile_y);
-
-    // replace original image surface
-    cairo_surface_destroy(surface);
-    surface = surface2;
-
-    cairo_rectangle(cr2, 0, 0,
-                    ceil(subtile_w),
-                    ceil(subtile_h));
-    cairo_fill(cr2);
-    success = _openslide_check_cairo_status(cr2, err);
-  }
-
-  cairo_set_source_surface(cr, surface, 0, 0);
-  cairo_paint(cr);
+  return _openslide_check_cairo_status(cr, err);
+}
 
-  return success;
+static bool read_subtile(openslide_t *osr,
+                         cairo_t *cr,
+                         struct _openslide_level *level,
+                         int64_t subtile_col, int64_t subtile_row,
+                         void *arg,
+                         GError **err) {
+  struct level *l = (struct level *) level;
+  return paint_subtile(osr, cr, level, subtile_col, subtile_row,
+                       l->tiffl.tile_w, l->tiffl.tile_h,
+                       arg, err);
 }
 
-// read_subtile wrapper for BIF that drops the extra argument passed by
-// the tilemap grid
+// BIF reader for the tilemap grid; the tile data is its placement
 static bool read_subtile_tilemap(openslide_t *osr,
                                  cairo_t *cr,
                                  struct _openslide_level *level,
                                  int64_t subtile_col, int64_t subtile_row,
-                                 void *subtile G_GNUC_UNUSED,
+                                 void *data,
                                  void *arg,
                                  GError **err) {
-  return read_subtile(osr, cr, level,
-                      subtile_col, subtile_row,
-                      arg, err);
+  struct placement *placement = data;
+  return paint_subtile(osr, cr, level,
+                       subtile_col, subtile_row,
+                       placement->w, placement->h,
+                       arg, err);
 }
 
 static bool paint_region(openslide_t *osr, cairo_t *cr,
@@ -275,34 +274,58 @@ static bool read_icc_profile(openslide_t *osr, void *dest, GError **err) {
   return _openslide_tiff_read_icc_profile(osr, &l->tiffl, ct.tiff, dest, err);
 }
 
+static uint64_t get_memory_usage(openslide_t *osr) {
+  struct ventana_ops_data *data = osr->data;
+  uint64_t total = sizeof(*data) +
+    _openslide_tiffcache_get_memory_usage(data->tc);
+  for (int32_t i = 0; i < osr->level_count; i++) {
+    struct level *l = (struct level *) osr->levels[i];
+    total += sizeof(*l) +
+      _openslide_grid_get_memory_usage(l->grid, sizeof(struct placement));
+  }
+  return total;
+}
+
 static const struct _openslide_ops ventana_ops = {
   .paint_region = paint_region,
   .read_icc_profile = read_icc_profile,
   .destroy = destroy,
+  .get_memory_usage = get_memory_usage,
 };
 
-static xmlNode *get_initial_xml_iscan(xmlDoc *doc, GError **err) {
-  xmlNode *root = xmlDocGetRootElement(doc);
-  if (!xmlStrcmp(root->name, BAD_CAST INITIAL_XML_ISCAN)) {
-    // /iScan
-    return root;
-
-  } else if (!xmlStrcmp(root->name, BAD_CAST INITIAL_XML_ALT_ROOT)) {
-    for (xmlNode *node = root->children; node; node = node->next) {
-      if (!xmlStrcmp(node->name, BAD_CAST INITIAL_XML_ISCAN)) {
-        // /Metadata/iScan, found in some slides
-        return node;
+// position the reader on /iScan or /Metadata/iScan without parsing the
+// rest of the packet
+static bool find_initial_xml_iscan(xmlTextReader *reader, GError **err) {
+  g_autoptr(GError) tmp_err = NULL;
+  if (_openslide_xml_reader_next_element(reader, 0, &tmp_err) == 0) {
+    const xmlChar *name = xmlTextReaderConstLocalName(reader);
+    if (!xmlStrcmp(name, BAD_CAST INITIAL_XML_ISCAN)) {
+      // /iScan
+      return true;
+
+    } else if (!xmlStrcmp(name, BAD_CAST INITIAL_XML_ALT_ROOT)) {
+      while (_openslide_xml_reader_next_element(reader, 1, &tmp_err) == 1) {
+        if (!xmlStrcmp(xmlTextReaderConstLocalName(reader),
+                       BAD_CAST INITIAL_XML_ISCAN)) {
+          // /Metadata/iScan, found in some slides
+          return true;
+        }
+      }
+      if (!tmp_err) {
+        g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                    "Couldn't find iScan element in initial XML");
+        return false;
       }
     }
-    g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
-                "Couldn't find iScan element in initial XML");
-    return NULL;
+  }
 
+  if (tmp_err) {
+    g_propagate_error(err, g_steal_pointer(&tmp_err));
   } else {
     g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
                 "Unrecognized root element in initial XML");
-    return NULL;
   }
+  return false;
 }
 
 static bool ventana_detect(const char *filename G_GNUC_UNUSED,
@@ -329,14 +352,17 @@ static bool ventana_detect(const char *filename G_GNUC_UNUSED,
     return false;
   }
 
-  // parse
-  g_autoptr(xmlDoc) doc = _openslide_xml_parse(xml, err);
-  if (!doc) {
+  // check for iScan element
+  g_autoptr(xmlTextReader) reader = _openslide_xml_reader_create(xml, err);
+  if (!reader) {
+    return false;
+  }
+  if (!find_initial_xml_iscan(reader, err)) {
     return false;
   }
 
-  // check for iScan element
-  if (!get_initial_xml_iscan(doc, err)) {
+  // malformed packets fall through to generic TIFF
+  if (!_openslide_xml_reader_check_rest(reader, err)) {
     return false;
   }
 
@@ -374,24 +400,27 @@ static int width_compare(gconstpointer a, gconstpointer b) {
 
 static bool parse_initial_xml(openslide_t *osr, const char *xml,
                               GError **err) {
-  // parse
-  g_autoptr(xmlDoc) doc = _openslide_xml_parse(xml, err);
-  if (!doc) {
+  // get iScan element
+  g_autoptr(xmlTextReader) reader = _openslide_xml_reader_create(xml, err);
+  if (!reader) {
     return false;
   }
-
-  // get iScan element
-  xmlNode *iscan = get_initial_xml_iscan(doc, err);
-  if (!iscan) {
+  if (!find_initial_xml_iscan(reader, err)) {
     return false;
   }
 
-  // copy all iScan attributes to vendor properties
-  for (xmlAttr *attr = iscan->properties; attr; attr = attr->next) {
-    g_autoptr(xmlChar) value = xmlGetNoNsProp(iscan, attr->name);
+  // copy all un-namespaced iScan attributes to vendor properties
+  for (int ret = xmlTextReaderMoveToFirstAttribute(reader); ret == 1;
+       ret = xmlTextReaderMoveToNextAttribute(reader)) {
+    if (xmlTextReaderIsNamespaceDecl(reader) ||
+        xmlTextReaderConstNamespaceUri(reader)) {
+      continue;
+    }
+    const xmlChar *value = xmlTextReaderConstValue(reader);
     if (value && *value) {
       g_hash_table_insert(osr->properties,
-                          g_strdup_printf("ventana.%s", attr->name),
+                          g_strdup_printf("ventana.%s",
+                                          xmlTextReaderConstLocalName(reader)),
                           g_strdup((char *) value));
     }
   }
@@ -681,35 +710,62 @@ static bool parse_level_info(const char *desc,
   return true;
 }
 
+// integer position of subtile n in an area
+static int64_t bif_subtile_pos(int64_t area_pos, int64_t n, double advance,
+                               double downsample) {
+  return llround((area_pos + n * advance) / downsample);
+}
+
 static struct _openslide_grid *create_bif_grid(openslide_t *osr,
                                                struct bif *bif,
                                                double downsample,
                                                int64_t tile_w, int64_t tile_h) {
-  double subtile_w = tile_w / downsample;
-  double subtile_h = tile_h / downsample;
+  double advance_x = bif->tile_advance_x / downsample;
+  double advance_y = bif->tile_advance_y / downsample;
+  int32_t subtile_w = tile_w / downsample;
+  int32_t subtile_h = tile_h / downsample;
 
   struct _openslide_grid *grid =
-    _openslide_grid_create_tilemap(osr,
-                                   bif->tile_advance_x / downsample,
-                                   bif->tile_advance_y / downsample,
-                                   read_subtile_tilemap, NULL);
-
+    _openslide_grid_create_tilemap(osr, advance_x, advance_y,
+                                   read_subtile_tilemap, g_free);
+
+  // Resolve the overlaps between neighboring subtiles into an integer
+  // placement table.  Each subtile starts at its rounded position and is
+  // cropped where the next subtile starts, so the overlap is painted by
+  // the right/bottom neighbor, as before, and no subtile lands on a
+  // fractional offset.
   for (int32_t i = 0; i < bif->num_areas; i++) {
     struct area *area = bif->areas[i];
-    double offset_x =
-      (area->x - area->start_col * bif->tile_advance_x) / downsample;
-    double offset_y =
-      (area->y - area->start_row * bif->tile_advance_y) / downsample;
-    //g_debug("ds %g area %d pos %"PRId64" %"PRId64" offset %g %g", downsample, i, area->x, area->y, offset_x, offset_y);
-    for (int64_t row = area->start_row;
-         row < area->start_row + area->tiles_down; row++) {
-      for (int64_t col = area->start_col;
-           col < area->start_col + area->tiles_across; col++) {
+    for (int64_t r = 0; r < area->tiles_down; r++) {
+      int64_t y = bif_subtile_pos(area->y, r, bif->tile_advance_y,
+                                  downsample);
+      int32_t h = subtile_h;
+      if (r < area->tiles_down - 1) {
+        int64_t next_y = bif_subtile_pos(area->y, r + 1,
+                                         bif->tile_advance_y, downsample);
+        h = CLAMP(next_y - y, 0, subtile_h);
+      }
+      int64_t row = area->start_row + r;
+      for (int64_t c = 0; c < area->tiles_across; c++) {
+        int64_t x = bif_subtile_pos(area->x, c, bif->tile_advance_x,
+                                    downsample);
+        int32_t w = subtile_w;
+        if (c < area->tiles_across - 1) {
+          int64_t next_x = bif_subtile_pos(area->x, c + 1,
+                                           bif->tile_advance_x, downsample);
+          w = CLAMP(next_x - x, 0, subtile_w);
+        }
+        int64_t col = area->start_col + c;
+
+        struct placement *placement = g_new(struct placement, 1);
+        placement->w = w;
+        placement->h = h;
         _openslide_grid_tilemap_add_tile(grid,
                                          col, row,
-                                         offset_x, offset_y,
-                                         subtile_w, subtile_h,
-                                         NULL);
+                                         x - col * advance_x,
+                                         y - row * advance_y,
+                                         w, h,
+                                         placement);
       }
     }
   }
@@ -717,6 +773,24 @@ static struct _openslide_grid *create_bif_grid(openslide_t *osr,
   return grid;
 }
 
+// level size in the unrounded tile geometry; the format doesn't seem to
+// record it, so make it large enough for all the pixels
+static void get_bif_level_size(struct bif *bif, double downsample,
+                               int64_t tile_w, int64_t tile_h,
+                               int64_t *w, int64_t *h) {
+  double right = 0;
+  double bottom = 0;
+  for (int32_t i = 0; i < bif->num_areas; i++) {
+    struct area *area = bif->areas[i];
+    right = MAX(right, area->x +
+                (area->tiles_across - 1) * bif->tile_advance_x + tile_w);
+    bottom = MAX(bottom, area->y +
+                 (area->tiles_down - 1) * bif->tile_advance_y + tile_h);
+  }
+  *w = ceil(right / downsample);
+  *h = ceil(bottom / downsample);
+}
+
 static void set_region_props(openslide_t *osr, struct bif *bif,
                              struct level *level0) {
   for (int32_t i = 0; i < bif->num_areas; i++) {
@@ -867,12 +941,9 @@ static bool ventana_open(openslide_t *osr, const char *filename,
                                   downsample,
                                   tiffl->tile_w, tiffl->tile_h);
         l->subtiles_per_tile = downsample;
-        // the format doesn't seem to record the level size, so make it
-        // large enough for all the pixels
-        double x, y, w, h;
-        _openslide_grid_get_bounds(l->grid, &x, &y, &w, &h);
-        l->base.w = ceil(x + w);
-        l->base.h = ceil(y + h);
+        get_bif_level_size(bif, downsample,
+                           tiffl->tile_w, tiffl->tile_h,
+                           &l->base.w, &l->base.h);
         // clear tile size hints set by _openslide_tiff_level_init()
         l->base.tile_w = 0;
         l->base.tile_h = 0;
@@ -235,11 +235,12 @@ static const struct associated_image_mapping {
   {"Thumbnail", "thumbnail"},
 };
 
-static const char * const metadata_property_xpaths[] = {
-  "/ImageDocument/Metadata/AttachmentInfos",
-  "/ImageDocument/Metadata/DisplaySetting",
-  "/ImageDocument/Metadata/Information",
-  "/ImageDocument/Metadata/Scaling",
+// children of /ImageDocument/Metadata that become properties
+static const char * const metadata_property_elements[] = {
+  "AttachmentInfos",
+  "DisplaySetting",
+  "Information",
+  "Scaling",
 };
 
 struct czi_subblk {
@@ -894,8 +895,43 @@ static char *read_czi_meta_xml(struct czi *czi,
   return g_steal_pointer(&xml);
 }
 
-static char *get_xml_element_name(GPtrArray *path, xmlNode *node) {
-  const char *name = (const char *) node->name;
+// a property collected while streaming; NULL once dropped
+struct xml_prop {
+  char *name;
+  char *value;
+};
+
+// the props produced by a child element, as a range of indexes
+struct xml_child {
+  char *name;
+  guint start;
+  guint end;
+};
+
+// an element whose end tag we haven't reached
+struct xml_frame {
+  guint start;
+  GArray *children;  // struct xml_child
+};
+
+static void xml_prop_clear(void *data) {
+  struct xml_prop *prop = data;
+  g_free(prop->name);
+  g_free(prop->value);
+}
+
+static void xml_child_clear(void *data) {
+  struct xml_child *child = data;
+  g_free(child->name);
+}
+
+static void xml_frame_free(struct xml_frame *frame) {
+  g_array_unref(frame->children);
+  g_free(frame);
+}
+
+static char *get_xml_element_name(GPtrArray *path, xmlTextReader *reader) {
+  const char *name = (const char *) xmlTextReaderConstLocalName(reader);
 
   g_autofree char *name_plural = g_strdup_printf("%ss", name);
   char *parent_name = path->pdata[path->len - 1];
@@ -904,9 +940,9 @@ static char *get_xml_element_name(GPtrArray *path, xmlNode *node) {
     // element array member: a path of the form "[...].Scenes.Scene", or as
     // a special case, "[...].Items.Distance"
     // find an XML attribute to use as a name
-    g_autoptr(xmlChar) id = xmlGetProp(node, BAD_CAST "Id");
+    g_autoptr(xmlChar) id = xmlTextReaderGetAttribute(reader, BAD_CAST "Id");
     if (!id) {
-      id = xmlGetProp(node, BAD_CAST "Name");
+      id = xmlTextReaderGetAttribute(reader, BAD_CAST "Name");
     }
     if (!id) {
       // can't find unique identifier; skip the element
@@ -920,73 +956,135 @@ static char *get_xml_element_name(GPtrArray *path, xmlNode *node) {
   return g_strdup(name);
 }
 
-static void add_xml_props(openslide_t *osr, xmlDoc *doc, GPtrArray *path,
-                          xmlNode *node) {
-  // If we don't know a good name for a property, skip it rather than use a
-  // bad name.  We can always add properties, but existing ones are a
-  // compatibility constraint.
-
-  if (xmlNodeIsText(node)) {
-    // text node (which has no children); add property if non-blank
-    if (!xmlIsBlankNode(node)) {
-      // glib >= 2.74 has g_ptr_array_new_null_terminated()
-      g_ptr_array_add(path, NULL);
-      char *name = g_strjoinv(".", (char **) path->pdata);
-      g_ptr_array_remove_index(path, path->len - 1);
-
-      g_hash_table_insert(osr->properties, name,
-                          g_strdup((char *) node->content));
+static bool is_blank(const char *value) {
+  for (const char *c = value; *c; c++) {
+    if (!strchr(" \t\n\r", *c)) {
+      return false;
     }
-    return;
   }
+  return true;
+}
 
-  // add path component
-  char *name = get_xml_element_name(path, node);
-  g_assert(name);
-  g_ptr_array_add(path, name);
-
-  // add properties for attributes
-  for (xmlAttr *attr = node->properties; attr; attr = attr->next) {
-    g_ptr_array_add(path, g_strdup((char *) attr->name));
-    add_xml_props(osr, doc, path, attr->children);
-    g_ptr_array_remove_index(path, path->len - 1);
+static void add_xml_prop(GArray *props, GPtrArray *path, const char *value) {
+  if (!value || is_blank(value)) {
+    return;
   }
+  // glib >= 2.74 has g_ptr_array_new_null_terminated()
+  g_ptr_array_add(path, NULL);
+  struct xml_prop prop = {
+    .name = g_strjoinv(".", (char **) path->pdata),
+    .value = g_strdup(value),
+  };
+  g_ptr_array_remove_index(path, path->len - 1);
+  g_array_append_val(props, prop);
+}
 
-  // build a set of children to skip: those where multiple children have the
-  // same name (otherwise their properties would clobber each other)
-  g_autoptr(GHashTable) child_names =
-    g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
-  g_autoptr(GHashTable) child_skip =
-    g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
-  for (xmlNode *child = node->children; child; child = child->next) {
-    if (xmlNodeIsText(child)) {
+// drop the props of children whose names collide, since their properties
+// would clobber each other
+static void drop_duplicate_children(GArray *props, GArray *children) {
+  g_autoptr(GHashTable) counts = g_hash_table_new(g_str_hash, g_str_equal);
+  for (guint i = 0; i < children->len; i++) {
+    struct xml_child *child = &g_array_index(children, struct xml_child, i);
+    guint count = GPOINTER_TO_UINT(g_hash_table_lookup(counts, child->name));
+    g_hash_table_insert(counts, child->name, GUINT_TO_POINTER(count + 1));
+  }
+  for (guint i = 0; i < children->len; i++) {
+    struct xml_child *child = &g_array_index(children, struct xml_child, i);
+    if (GPOINTER_TO_UINT(g_hash_table_lookup(counts, child->name)) < 2) {
       continue;
     }
-    char *child_name = get_xml_element_name(path, child);
-    if (child_name && !g_hash_table_add(child_names, child_name)) {
-      g_hash_table_add(child_skip, g_strdup(child_name));
+    //g_debug("Skipping duplicate element: %s", child->name);
+    for (guint j = child->start; j < child->end; j++) {
+      xml_prop_clear(&g_array_index(props, struct xml_prop, j));
+      g_array_index(props, struct xml_prop, j) = (struct xml_prop) {0};
     }
   }
+}
+
+// finish the element at the end of path, whose props start at start
+static void close_xml_element(GArray *props, GPtrArray *path,
+                              GPtrArray *frames, guint start) {
+  if (frames->len) {
+    struct xml_frame *parent = frames->pdata[frames->len - 1];
+    struct xml_child child = {
+      .name = g_strdup(path->pdata[path->len - 1]),
+      .start = start,
+      .end = props->len,
+    };
+    g_array_append_val(parent->children, child);
+  }
+  g_ptr_array_remove_index(path, path->len - 1);
+}
 
-  // descend children
-  for (xmlNode *child = node->children; child; child = child->next) {
-    if (!xmlNodeIsText(child)) {
-      g_autofree char *child_name = get_xml_element_name(path, child);
-      if (!child_name) {
+// Collect props for the element at the reader and its subtree, in document
+// order, without building a tree.  Leaves the reader on the element's end
+// tag, or on the element itself if it's empty or skipped.
+static bool read_xml_props(xmlTextReader *reader, GPtrArray *path,
+                           GArray *props, GError **err) {
+  // If we don't know a good name for a property, skip it rather than use a
+  // bad name.  We can always add properties, but existing ones are a
+  // compatibility constraint.
+  g_autoptr(GPtrArray) frames =
+    g_ptr_array_new_with_free_func((GDestroyNotify) xml_frame_free);
+  while (true) {
+    bool skip = false;
+    switch (xmlTextReaderNodeType(reader)) {
+    case XML_READER_TYPE_ELEMENT: {
+      char *name = get_xml_element_name(path, reader);
+      if (!name) {
         // list element that we don't know how to uniquely rename
-        continue;
+        skip = true;
+        break;
+      }
+      guint start = props->len;
+      g_ptr_array_add(path, name);
+
+      // add properties for attributes
+      while (xmlTextReaderMoveToNextAttribute(reader) == 1) {
+        if (xmlTextReaderIsNamespaceDecl(reader)) {
+          continue;
+        }
+        g_ptr_array_add(path,
+                        g_strdup((char *) xmlTextReaderConstLocalName(reader)));
+        add_xml_prop(props, path, (char *) xmlTextReaderConstValue(reader));
+        g_ptr_array_remove_index(path, path->len - 1);
       }
-      if (g_hash_table_lookup(child_skip, child_name)) {
-        // duplicate name
-        //g_debug("Skipping duplicate element: %s", child_name);
-        continue;
+      xmlTextReaderMoveToElement(reader);
+
+      if (xmlTextReaderIsEmptyElement(reader)) {
+        close_xml_element(props, path, frames, start);
+      } else {
+        struct xml_frame *frame = g_new0(struct xml_frame, 1);
+        frame->start = start;
+        frame->children = g_array_new(false, false, sizeof(struct xml_child));
+        g_array_set_clear_func(frame->children, xml_child_clear);
+        g_ptr_array_add(frames, frame);
       }
+      break;
+    }
+    case XML_READER_TYPE_TEXT:
+      add_xml_prop(props, path, (char *) xmlTextReaderConstValue(reader));
+      break;
+    case XML_READER_TYPE_END_ELEMENT: {
+      struct xml_frame *frame = frames->pdata[frames->len - 1];
+      guint start = frame->start;
+      drop_duplicate_children(props, frame->children);
+      g_ptr_array_remove_index(frames, frames->len - 1);
+      close_xml_element(props, path, frames, start);
+      break;
+    }
     }
-    add_xml_props(osr, doc, path, child);
-  }
 
-  // drop path component
-  g_ptr_array_remove_index(path, path->len - 1);
+    if (!frames->len) {
+      return true;
+    }
+    int ret = skip ? xmlTextReaderNext(reader) : xmlTextReaderRead(reader);
+    if (ret != 1) {
+      g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                  "Could not parse XML");
+      return false;
+    }
+  }
 }
 
 /* parse version number such as 3.5.093.8 into major ver * 1000 + minor ver */
@@ -1015,8 +1113,8 @@ static int64_t parse_zen_version(const char *s, GError **err) {
 // parse XML, set CZI parameters and OpenSlide properties
 static bool parse_xml_set_prop(openslide_t *osr, struct czi *czi,
                                const char *xml, GError **err) {
-  g_autoptr(xmlDoc) doc = _openslide_xml_parse(xml, err);
-  if (doc == NULL) {
+  g_autoptr(xmlTextReader) reader = _openslide_xml_reader_create(xml, err);
+  if (reader == NULL) {
     g_prefix_error(err, "Couldn't parse metadata XML: ");
     return false;
   }
@@ -1061,15 +1159,63 @@ static bool parse_xml_set_prop(openslide_t *osr, struct czi *czi,
                       <Distance Id="Y">  (mpp Y)
                           Value
   */
-  g_autoptr(xmlXPathContext) ctx = _openslide_xml_xpath_create(doc);
+  // The metadata is large, so stream it rather than building a tree.
+  // Collect props for each section, and keep a section only if it
+  // appears exactly once.
+  g_autoptr(GPtrArray) sections =
+    g_ptr_array_new_with_free_func((GDestroyNotify) g_array_unref);
+  unsigned section_counts[G_N_ELEMENTS(metadata_property_elements)] = {0};
+  for (unsigned i = 0; i < G_N_ELEMENTS(metadata_property_elements); i++) {
+    GArray *props = g_array_new(false, false, sizeof(struct xml_prop));
+    g_array_set_clear_func(props, xml_prop_clear);
+    g_ptr_array_add(sections, props);
+  }
 
   g_autoptr(GPtrArray) path = g_ptr_array_new_full(16, g_free);
   g_ptr_array_add(path, g_strdup("zeiss"));
-  for (unsigned i = 0; i < G_N_ELEMENTS(metadata_property_xpaths); i++) {
-    xmlNode *node =
-      _openslide_xml_xpath_get_node(ctx, metadata_property_xpaths[i]);
-    if (node) {
-      add_xml_props(osr, doc, path, node);
+  bool in_metadata = false;
+  GError *tmp_err = NULL;
+  int depth;
+  while ((depth = _openslide_xml_reader_next_element(reader, 2,
+                                                     &tmp_err)) != -1) {
+    const char *name = (const char *) xmlTextReaderConstLocalName(reader);
+    bool no_ns = xmlTextReaderConstNamespaceUri(reader) == NULL;
+    if (depth == 0) {
+      if (!no_ns || !g_str_equal(name, "ImageDocument")) {
+        break;
+      }
+    } else if (depth == 1) {
+      in_metadata = no_ns && g_str_equal(name, "Metadata");
+    } else if (in_metadata && no_ns) {
+      for (unsigned i = 0; i < G_N_ELEMENTS(metadata_property_elements); i++) {
+        if (g_str_equal(name, metadata_property_elements[i])) {
+          if (section_counts[i]++ == 0 &&
+              !read_xml_props(reader, path, sections->pdata[i], err)) {
+            g_prefix_error(err, "Couldn't parse metadata XML: ");
+            return false;
+          }
+          break;
+        }
+      }
+    }
+  }
+  if (tmp_err) {
+    g_propagate_prefixed_error(err, tmp_err,
+                               "Couldn't parse metadata XML: ");
+    return false;
+  }
+  for (unsigned i = 0; i < G_N_ELEMENTS(metadata_property_elements); i++) {
+    if (section_counts[i] != 1) {
+      continue;
+    }
+    GArray *props = sections->pdata[i];
+    for (guint j = 0; j < props->len; j++) {
+      struct xml_prop *prop = &g_array_index(props, struct xml_prop, j);
+      if (prop->name) {
+        g_hash_table_insert(osr->properties,
+                            g_steal_pointer(&prop->name),
+                            g_steal_pointer(&prop->value));
+      }
     }
   }
 
@@ -41,6 +41,7 @@ static const char * const EMPTY_STRING_ARRAY[] = { NULL };
 
 static const struct _openslide_format *formats[] = {
   &_openslide_format_synthetic,
+  &_openslide_format_synthetic_slide,
   &_openslide_format_mirax,
   &_openslide_format_zeiss,
   &_openslide_format_dicom,
@@ -64,6 +65,8 @@ static void __attribute__((constructor)) _openslide_init(void) {
   xmlInitParser();
   // parse debug options
   _openslide_debug_init();
+  // start access trace, if requested
+  _openslide_trace_init();
   openslide_was_dynamically_loaded = true;
 }
 
@@ -202,9 +205,24 @@ static const char **strv_from_hashtable_keys(GHashTable *h) {
   return result;
 }
 
-openslide_t *openslide_open(const char *filename) {
-  g_assert(openslide_was_dynamically_loaded);
+// geometry of the named associated image, or NULL
+static const struct _openslide_associated_image *
+get_associated_image_info(openslide_t *osr, const char *name) {
+  // names are unset if open failed
+  if (!name || !osr->associated_image_names) {
+    return NULL;
+  }
+  const char **found =
+    bsearch(&name, osr->associated_image_names,
+            g_hash_table_size(osr->associated_images), sizeof(char *),
+            cmpstring);
+  if (!found) {
+    return NULL;
+  }
+  return &osr->associated_image_info[found - osr->associated_image_names];
+}
 
+static openslide_t *open_slide(const char *filename) {
   // detect format
   g_autoptr(_openslide_tifflike) tl = NULL;
   const struct _openslide_format *format = detect_format(filename, &tl);
@@ -220,6 +238,8 @@ openslide_t *openslide_open(const char *filename) {
   osr->associated_images = g_hash_table_new_full(g_str_hash, g_str_equal,
                                                  g_free,
                                                  destroy_associated_image);
+  osr->filename = g_strdup(filename);
+  g_rw_lock_init(&osr->backend_lock);
 
   // refuse to run on unpatched pixman 0.38.x
   static GOnce pixman_once = G_ONCE_INIT;
@@ -269,13 +289,19 @@ openslide_t *openslide_open(const char *filename) {
     }
   }
 
-  // set hash property
+  // set hash properties
   const char *hash_str = _openslide_hash_get_string(quickhash1);
   if (hash_str != NULL) {
     g_hash_table_insert(osr->properties,
                         g_strdup(OPENSLIDE_PROPERTY_NAME_QUICKHASH1),
                         g_strdup(hash_str));
   }
+  hash_str = _openslide_hash_get_quickhash2_string(quickhash1);
+  if (hash_str != NULL) {
+    g_hash_table_insert(osr->properties,
+                        g_strdup(OPENSLIDE_PROPERTY_NAME_QUICKHASH2),
+                        g_strdup(hash_str));
+  }
 
   // set other properties
   g_hash_table_insert(osr->properties,
@@ -321,11 +347,25 @@ openslide_t *openslide_open(const char *filename) {
     }
   }
 
+  // copy level geometry for the getters
+  osr->level_info = g_new(struct _openslide_level, osr->level_count);
+  for (int32_t i = 0; i < osr->level_count; i++) {
+    osr->level_info[i] = *osr->levels[i];
+  }
+
   // fill in associated image names and set properties
   osr->associated_image_names = strv_from_hashtable_keys(osr->associated_images);
+  osr->associated_image_info =
+    g_new0(struct _openslide_associated_image,
+           g_hash_table_size(osr->associated_images));
   for (const char **name = osr->associated_image_names; *name != NULL; name++) {
     struct _openslide_associated_image *img =
       g_hash_table_lookup(osr->associated_images, *name);
+    struct _openslide_associated_image *info =
+      &osr->associated_image_info[name - osr->associated_image_names];
+    info->w = img->w;
+    info->h = img->h;
+    info->icc_profile_size = img->icc_profile_size;
     g_hash_table_insert(osr->properties,
 			g_strdup_printf(_OPENSLIDE_PROPERTY_NAME_TEMPLATE_ASSOCIATED_WIDTH, *name),
 			g_strdup_printf("%"PRId64, img->w));
@@ -350,8 +390,32 @@ openslide_t *openslide_open(const char *filename) {
   return g_steal_pointer(&osr);
 }
 
+openslide_t *openslide_open(const char *filename) {
+  g_assert(openslide_was_dynamically_loaded);
+
+  int64_t trace_start = _openslide_trace_start();
+  openslide_t *osr = open_slide(filename);
+  if (osr) {
+    osr->perf = _openslide_perf_create(filename);
+  }
+  _openslide_trace_open(trace_start, osr, filename);
+  if (_OPENSLIDE_PROBE_ENABLED(open)) {
+    _OPENSLIDE_PROBE(open, filename, osr,
+                     osr ? openslide_get_property_value(osr,
+                                     OPENSLIDE_PROPERTY_NAME_VENDOR) : NULL);
+  }
+  return osr;
+}
+
+static void close_slide(openslide_t *osr) {
+  if (osr->pool) {
+    _openslide_handle_pool_remove(osr->pool, osr);
+    // wait for another thread that's parking us
+    g_rw_lock_writer_lock(&osr->backend_lock);
+    g_rw_lock_writer_unlock(&osr->backend_lock);
+    _openslide_handle_pool_unref(osr->pool);
+  }
 
-void openslide_close(openslide_t *osr) {
   if (osr->ops) {
     (osr->ops->destroy)(osr);
   }
@@ -361,6 +425,8 @@ void openslide_close(openslide_t *osr) {
 
   g_free(osr->associated_image_names);
   g_free(osr->property_names);
+  g_free(osr->level_info);
+  g_free(osr->associated_image_info);
 
   if (osr->cache) {
     _openslide_cache_binding_destroy(osr->cache);
@@ -368,9 +434,271 @@ void openslide_close(openslide_t *osr) {
 
   g_free(g_atomic_pointer_get(&osr->error));
 
+  _openslide_perf_destroy(osr->perf);
+
+  g_rw_lock_clear(&osr->backend_lock);
+  g_free(osr->filename);
   g_free(osr);
 }
 
+void openslide_close(openslide_t *osr) {
+  int64_t trace_start = _openslide_trace_start();
+  uint32_t trace_handle = osr->trace_handle;
+
+  close_slide(osr);
+
+  _openslide_trace_close(trace_start, trace_handle);
+}
+
+// Stand-in for an associated image of a parked backend.  Reads go to the
+// reopened backend, if any.
+struct parked_associated_image {
+  struct _openslide_associated_image base;
+  openslide_t *osr;
+  const char *name;  // key in osr->associated_images
+};
+
+static struct _openslide_associated_image *
+get_reopened_associated_image(struct _openslide_associated_image *_img) {
+  struct parked_associated_image *img =
+    (struct parked_associated_image *) _img;
+  // names were checked when reopening
+  struct _openslide_associated_image *real =
+    g_hash_table_lookup(img->osr->backend->associated_images, img->name);
+  g_assert(real);
+  return real;
+}
+
+static bool reopened_get_associated_image_argb_data(struct _openslide_associated_image *img,
+                                                    uint32_t *dest,
+                                                    GError **err) {
+  struct _openslide_associated_image *real =
+    get_reopened_associated_image(img);
+  return real->ops->get_argb_data(real, dest, err);
+}
+
+static bool reopened_read_associated_image_icc_profile(struct _openslide_associated_image *img,
+                                                       void *dest,
+                                                       GError **err) {
+  struct _openslide_associated_image *real =
+    get_reopened_associated_image(img);
+  return real->ops->read_icc_profile(real, dest, err);
+}
+
+static void parked_destroy_associated_image(struct _openslide_associated_image *img) {
+  g_free(img);
+}
+
+static const struct _openslide_associated_image_ops reopened_associated_ops = {
+  .get_argb_data = reopened_get_associated_image_argb_data,
+  .read_icc_profile = reopened_read_associated_image_icc_profile,
+  .destroy = parked_destroy_associated_image,
+};
+
+// Once parked, a handle's levels point into level_info, and reads are
+// forwarded to a backend reopened into a separate handle
+static bool reopened_paint_region(openslide_t *osr, cairo_t *cr,
+                                  int64_t x, int64_t y,
+                                  struct _openslide_level *level,
+                                  int32_t w, int32_t h,
+                                  GError **err) {
+  openslide_t *backend = osr->backend;
+  for (int32_t i = 0; i < osr->level_count; i++) {
+    if (osr->levels[i] == level) {
+      return backend->ops->paint_region(backend, cr, x, y,
+                                        backend->levels[i], w, h, err);
+    }
+  }
+  g_assert_not_reached();
+  return false;
+}
+
+static bool reopened_read_icc_profile(openslide_t *osr, void *dest,
+                                      GError **err) {
+  openslide_t *backend = osr->backend;
+  return backend->ops->read_icc_profile(backend, dest, err);
+}
+
+static void close_reopened_backend(openslide_t *osr) {
+  if (osr->backend) {
+    // the cache binding is ours
+    osr->backend->cache = NULL;
+    close_slide(osr->backend);
+    osr->backend = NULL;
+  }
+}
+
+static void reopened_destroy(openslide_t *osr) {
+  close_reopened_backend(osr);
+  g_free(osr->levels);
+}
+
+static uint64_t reopened_get_memory_usage(openslide_t *osr) {
+  uint64_t total = osr->level_count * sizeof(struct _openslide_level *);
+  openslide_t *backend = osr->backend;
+  if (backend && backend->ops->get_memory_usage) {
+    total += backend->ops->get_memory_usage(backend);
+  }
+  return total;
+}
+
+static const struct _openslide_ops reopened_ops = {
+  .paint_region = reopened_paint_region,
+  .read_icc_profile = reopened_read_icc_profile,
+  .destroy = reopened_destroy,
+  .get_memory_usage = reopened_get_memory_usage,
+};
+
+void _openslide_park_backend(openslide_t *osr) {
+  if (osr->ops == &reopened_ops) {
+    close_reopened_backend(osr);
+  } else {
+    // swap in stand-ins for the associated images, keeping the keys,
+    // which are in associated_image_names.  destroy the old images
+    // before the backend they belong to.
+    g_autoptr(GPtrArray) old_images =
+      g_ptr_array_new_with_free_func(destroy_associated_image);
+    for (const char **name = osr->associated_image_names; *name; name++) {
+      void *key;
+      void *value;
+      g_hash_table_lookup_extended(osr->associated_images, *name,
+                                   &key, &value);
+      g_hash_table_steal(osr->associated_images, key);
+      g_ptr_array_add(old_images, value);
+
+      const struct _openslide_associated_image *info =
+        get_associated_image_info(osr, *name);
+      struct parked_associated_image *img =
+        g_new0(struct parked_associated_image, 1);
+      img->base = *info;
+      img->base.ops = &reopened_associated_ops;
+      img->osr = osr;
+      img->name = key;
+      g_hash_table_insert(osr->associated_images, key, img);
+    }
+    g_clear_pointer(&old_images, g_ptr_array_unref);
+
+    struct _openslide_level **levels =
+      g_new(struct _openslide_level *, osr->level_count);
+    for (int32_t i = 0; i < osr->level_count; i++) {
+      levels[i] = &osr->level_info[i];
+    }
+    (osr->ops->destroy)(osr);
+    osr->ops = &reopened_ops;
+    osr->levels = levels;
+    osr->data = NULL;
+  }
+
+  // cached tiles are keyed by backend pointers, which may be reused
+  _openslide_cache_binding_renew(osr->cache);
+  osr->parked = true;
+}
+
+// whether a reopened backend matches the geometry we report
+static bool same_slide(openslide_t *osr, openslide_t *backend) {
+  // quickhash-1 is omitted for slides with a large lowest level
+  const char *hash_name = OPENSLIDE_PROPERTY_NAME_QUICKHASH1;
+  if (!openslide_get_property_value(osr, hash_name)) {
+    hash_name = OPENSLIDE_PROPERTY_NAME_QUICKHASH2;
+  }
+  if (g_strcmp0(openslide_get_property_value(osr, hash_name),
+                openslide_get_property_value(backend, hash_name))) {
+    return false;
+  }
+
+  if (backend->level_count != osr->level_count ||
+      backend->icc_profile_size != osr->icc_profile_size) {
+    return false;
+  }
+  for (int32_t i = 0; i < osr->level_count; i++) {
+    const struct _openslide_level *a = &osr->level_info[i];
+    const struct _openslide_level *b = &backend->level_info[i];
+    if (a->w != b->w || a->h != b->h || a->downsample != b->downsample ||
+        a->tile_w != b->tile_w || a->tile_h != b->tile_h) {
+      return false;
+    }
+  }
+
+  if (g_hash_table_size(backend->associated_images) !=
+      g_hash_table_size(osr->associated_images)) {
+    return false;
+  }
+  for (const char **name = osr->associated_image_names; *name; name++) {
+    const struct _openslide_associated_image *a =
+      get_associated_image_info(osr, *name);
+    const struct _openslide_associated_image *b =
+      get_associated_image_info(backend, *name);
+    if (!b || a->w != b->w || a->h != b->h ||
+        a->icc_profile_size != b->icc_profile_size) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool reopen_backend(openslide_t *osr, GError **err) {
+  g_assert(osr->parked && !osr->backend);
+
+  openslide_t *backend = open_slide(osr->filename);
+  if (!backend) {
+    g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                "Couldn't reopen %s: format not recognized", osr->filename);
+    return false;
+  }
+  const char *msg = openslide_get_error(backend);
+  if (msg) {
+    g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                "Couldn't reopen %s: %s", osr->filename, msg);
+    close_slide(backend);
+    return false;
+  }
+
+  if (!same_slide(osr, backend)) {
+    g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                "Couldn't reopen %s: slide has changed", osr->filename);
+    close_slide(backend);
+    return false;
+  }
+
+  // share our cache binding
+  _openslide_cache_binding_destroy(backend->cache);
+  backend->cache = osr->cache;
+
+  osr->backend = backend;
+  osr->parked = false;
+  return true;
+}
+
+// Lock the backend for reading pixels, reopening it if parked, and
+// count the use against the handle pool.  On failure, the handle is in
+// error state and the lock is not held.
+static bool backend_acquire(openslide_t *osr) {
+  while (true) {
+    g_rw_lock_reader_lock(&osr->backend_lock);
+    if (!osr->parked) {
+      break;
+    }
+    g_rw_lock_reader_unlock(&osr->backend_lock);
+
+    g_rw_lock_writer_lock(&osr->backend_lock);
+    GError *tmp_err = NULL;
+    bool ok = !osr->parked || reopen_backend(osr, &tmp_err);
+    g_rw_lock_writer_unlock(&osr->backend_lock);
+    if (!ok) {
+      _openslide_propagate_error(osr, tmp_err);
+      return false;
+    }
+  }
+  if (osr->pool) {
+    _openslide_handle_pool_touch(osr->pool, osr);
+  }
+  return true;
+}
+
+static void backend_release(openslide_t *osr) {
+  g_rw_lock_reader_unlock(&osr->backend_lock);
+}
+
 
 void openslide_get_level0_dimensions(openslide_t *osr,
                                      int64_t *w, int64_t *h) {
@@ -390,8 +718,8 @@ void openslide_get_level_dimensions(openslide_t *osr, int32_t level,
     return;
   }
 
-  *w = osr->levels[level]->w;
-  *h = osr->levels[level]->h;
+  *w = osr->level_info[level].w;
+  *h = osr->level_info[level].h;
 }
 
 
@@ -411,13 +739,13 @@ int32_t openslide_get_best_level_for_downsample(openslide_t *osr,
   }
 
   // too small, return first
-  if (downsample < osr->levels[0]->downsample) {
+  if (downsample < osr->level_info[0].downsample) {
     return 0;
   }
 
   // find where we are in the middle
   for (int32_t i = 1; i < osr->level_count; i++) {
-    if (downsample < osr->levels[i]->downsample) {
+    if (downsample < osr->level_info[i].downsample) {
       return i - 1;
     }
   }
@@ -432,7 +760,7 @@ double openslide_get_level_downsample(openslide_t *osr, int32_t level) {
     return -1.0;
   }
 
-  return osr->levels[level]->downsample;
+  return osr->level_info[level].downsample;
 }
 
 
@@ -442,6 +770,10 @@ static bool read_region_area(openslide_t *osr,
                              int32_t level,
                              int64_t w, int64_t h,
                              GError **err) {
+  // time not charged to a more specific stage
+  g_auto(_openslide_perf_timer) timer G_GNUC_UNUSED =
+    _openslide_perf_start(OPENSLIDE_PERF_COMPOSITE);
+
   // create the cairo surface for the dest
   g_autoptr(cairo_surface_t) surface = NULL;
   if (dest) {
@@ -495,11 +827,11 @@ static bool read_region_area(openslide_t *osr,
   return true;
 }
 
-void openslide_read_region(openslide_t *osr,
-			   uint32_t *dest,
-			   int64_t x, int64_t y,
-			   int32_t level,
-			   int64_t w, int64_t h) {
+static void read_region(openslide_t *osr,
+                        uint32_t *dest,
+                        int64_t x, int64_t y,
+                        int32_t level,
+                        int64_t w, int64_t h) {
   if (w < 0 || h < 0) {
     GError *tmp_err = g_error_new(OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
                                   "negative width (%"PRId64") "
@@ -526,6 +858,9 @@ void openslide_read_region(openslide_t *osr,
   //    be addressable in 31 bits.
   const int64_t d = 4096;
   double ds = openslide_get_level_downsample(osr, level);
+  if (!backend_acquire(osr)) {
+    return;
+  }
   for (int64_t row = 0; row < (h + d - 1) / d; row++) {
     for (int64_t col = 0; col < (w + d - 1) / d; col++) {
       // calculate surface coordinates and size
@@ -540,6 +875,7 @@ void openslide_read_region(openslide_t *osr,
                             dest ? dest + w * row * d + col * d : NULL, w * 4,
                             sx, sy, level, sw, sh,
                             &tmp_err)) {
+        backend_release(osr);
         _openslide_propagate_error(osr, tmp_err);
         if (dest) {
           // ensure we don't return a partial result
@@ -549,6 +885,143 @@ void openslide_read_region(openslide_t *osr,
       }
     }
   }
+  backend_release(osr);
+}
+
+void openslide_read_region(openslide_t *osr,
+			   uint32_t *dest,
+			   int64_t x, int64_t y,
+			   int32_t level,
+			   int64_t w, int64_t h) {
+  int64_t trace_start = _openslide_trace_start();
+  _OPENSLIDE_PROBE(read__region__start, osr, x, y, level, w, h);
+  struct _openslide_perf *prev_perf = _openslide_perf_enter(osr->perf);
+  read_region(osr, dest, x, y, level, w, h);
+  _openslide_perf_leave(osr->perf, prev_perf);
+  _OPENSLIDE_PROBE(read__region__end, osr, x, y, level, w, h);
+  _openslide_trace_read_region(trace_start, osr, x, y, level, w, h);
+}
+
+// length of a span starting at level-plane coordinate pos, at most max
+// and ending on a tile boundary if possible
+static int64_t tile_aligned_span(int64_t pos, int64_t tile, int64_t max) {
+  if (tile <= 0 || tile > max) {
+    return max;
+  }
+  int64_t offset = ((pos % tile) + tile) % tile;
+  return max / tile * tile - offset;
+}
+
+static void read_region_stream(openslide_t *osr,
+                               int64_t x, int64_t y,
+                               int32_t level,
+                               int64_t w, int64_t h,
+                               int64_t band_h,
+                               openslide_band_callback callback,
+                               void *user_data) {
+  if (w < 0 || h < 0 || band_h <= 0 || !callback) {
+    GError *tmp_err = g_error_new(OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                                  "invalid arguments to "
+                                  "openslide_read_region_stream()");
+    _openslide_propagate_error(osr, tmp_err);
+    return;
+  }
+  if (openslide_get_error(osr) || !w || !h) {
+    return;
+  }
+
+  // Read whole rows of tiles at a time, split into columns on tile
+  // boundaries, so no tile is painted into two reads.  Cairo limits
+  // the size of each read; see read_region().
+  const int64_t d = 4096;
+  double ds = openslide_get_level_downsample(osr, level);
+  int64_t tile_w = 0;
+  int64_t tile_h = 0;
+  if (level_in_range(osr, level)) {
+    tile_w = osr->level_info[level].tile_w;
+    tile_h = osr->level_info[level].tile_h;
+  }
+  if (tile_h <= 0) {
+    // no uniform tile grid, e.g. Ventana's overlapping tiles.  Align
+    // strips to a nominal tile height so that tiles straddle fewer strip
+    // boundaries than they would with one strip per band.
+    tile_h = 256;
+  }
+  int64_t strip_max = MIN(MAX(band_h, tile_h), d);
+  int64_t capacity = band_h + strip_max;
+  if (capacity > G_MAXSIZE / 4 / w) {
+    GError *tmp_err = g_error_new(OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                                  "Band of %"PRId64"x%"PRId64" is too large",
+                                  w, capacity);
+    _openslide_propagate_error(osr, tmp_err);
+    return;
+  }
+  g_autofree uint32_t *buf = g_try_malloc(capacity * w * 4);
+  if (!buf) {
+    GError *tmp_err = g_error_new(OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                                  "Couldn't allocate %"PRId64"x%"PRId64" band",
+                                  w, capacity);
+    _openslide_propagate_error(osr, tmp_err);
+    return;
+  }
+
+  int64_t start_x = x / ds;
+  int64_t start_y = y / ds;
+  int64_t read = 0;     // rows read from the slide
+  int64_t emitted = 0;  // rows delivered
+  int64_t filled = 0;   // rows in buf
+  while (emitted < h) {
+    while (filled < band_h && read < h) {
+      // next strip of tile rows
+      int64_t sh = MIN(tile_aligned_span(start_y + read, tile_h, strip_max),
+                       h - read);
+      uint32_t *strip = buf + filled * w;
+      memset(strip, 0, sh * w * 4);
+      // don't hold the backend across callbacks
+      if (!backend_acquire(osr)) {
+        return;
+      }
+      for (int64_t col = 0; col < w; ) {
+        int64_t sw = MIN(tile_aligned_span(start_x + col, tile_w, d),
+                         w - col);
+        GError *tmp_err = NULL;
+        if (!read_region_area(osr, strip + col, w * 4,
+                              x + col * ds, y + read * ds, level, sw, sh,
+                              &tmp_err)) {
+          backend_release(osr);
+          _openslide_propagate_error(osr, tmp_err);
+          return;
+        }
+        col += sw;
+      }
+      backend_release(osr);
+      read += sh;
+      filled += sh;
+    }
+
+    int64_t rows = MIN(band_h, filled);
+    if (!callback(buf, emitted, rows, user_data)) {
+      return;
+    }
+    emitted += rows;
+    filled -= rows;
+    memmove(buf, buf + rows * w, filled * w * 4);
+  }
+}
+
+void openslide_read_region_stream(openslide_t *osr,
+                                  int64_t x, int64_t y,
+                                  int32_t level,
+                                  int64_t w, int64_t h,
+                                  int64_t band_h,
+                                  openslide_band_callback callback,
+                                  void *user_data) {
+  int64_t trace_start = _openslide_trace_start();
+  struct _openslide_perf *prev_perf = _openslide_perf_enter(osr->perf);
+  read_region_stream(osr, x, y, level, w, h, band_h, callback, user_data);
+  _openslide_perf_leave(osr->perf, prev_perf);
+  _openslide_trace_read_region_stream(trace_start, osr, x, y, level, w, h,
+                                      band_h);
 }
 
 const char * const *openslide_get_property_names(openslide_t *osr) {
@@ -583,10 +1056,16 @@ void openslide_read_icc_profile(openslide_t *osr, void *dest) {
   if (!osr->icc_profile_size) {
     return;
   }
+  if (!backend_acquire(osr)) {
+    memset(dest, 0, osr->icc_profile_size);
+    return;
+  }
   g_assert(osr->ops->read_icc_profile);
 
   GError *tmp_err = NULL;
-  if (!osr->ops->read_icc_profile(osr, dest, &tmp_err)) {
+  bool ok = osr->ops->read_icc_profile(osr, dest, &tmp_err);
+  backend_release(osr);
+  if (!ok) {
     _openslide_propagate_error(osr, tmp_err);
     memset(dest, 0, osr->icc_profile_size);
   }
@@ -609,35 +1088,47 @@ void openslide_get_associated_image_dimensions(openslide_t *osr, const char *nam
     return;
   }
 
-  struct _openslide_associated_image *img = g_hash_table_lookup(osr->associated_images,
-								name);
-  if (img) {
-    *w = img->w;
-    *h = img->h;
+  const struct _openslide_associated_image *info =
+    get_associated_image_info(osr, name);
+  if (info) {
+    *w = info->w;
+    *h = info->h;
   }
 }
 
 void openslide_read_associated_image(openslide_t *osr,
 				     const char *name,
 				     uint32_t *dest) {
-  struct _openslide_associated_image *img =
-    g_hash_table_lookup(osr->associated_images, name);
-  if (!img) {
+  const struct _openslide_associated_image *info =
+    get_associated_image_info(osr, name);
+  if (!info) {
     return;
   }
-  size_t pixels = img->w * img->h;
+  size_t pixels = info->w * info->h;
 
   if (openslide_get_error(osr)) {
     memset(dest, 0, pixels * sizeof(uint32_t));
     return;
   }
 
-  GError *tmp_err = NULL;
-  if (!img->ops->get_argb_data(img, dest, &tmp_err)) {
-    _openslide_propagate_error(osr, tmp_err);
-    // ensure we don't return a partial result
+  int64_t trace_start = _openslide_trace_start();
+  struct _openslide_perf *prev_perf = _openslide_perf_enter(osr->perf);
+  if (backend_acquire(osr)) {
+    struct _openslide_associated_image *img =
+      g_hash_table_lookup(osr->associated_images, name);
+    GError *tmp_err = NULL;
+    bool ok = img->ops->get_argb_data(img, dest, &tmp_err);
+    backend_release(osr);
+    if (!ok) {
+      _openslide_propagate_error(osr, tmp_err);
+      // ensure we don't return a partial result
+      memset(dest, 0, pixels * sizeof(uint32_t));
+    }
+  } else {
     memset(dest, 0, pixels * sizeof(uint32_t));
   }
+  _openslide_perf_leave(osr->perf, prev_perf);
+  _openslide_trace_read_associated_image(trace_start, osr, name);
 }
 
 int64_t openslide_get_associated_image_icc_profile_size(openslide_t *osr,
@@ -646,36 +1137,45 @@ int64_t openslide_get_associated_image_icc_profile_size(openslide_t *osr,
     return -1;
   }
 
-  struct _openslide_associated_image *img =
-    g_hash_table_lookup(osr->associated_images, name);
-  if (!img) {
+  const struct _openslide_associated_image *info =
+    get_associated_image_info(osr, name);
+  if (!info) {
     return -1;
   }
-  return img->icc_profile_size;
+  return info->icc_profile_size;
 }
 
 void openslide_read_associated_image_icc_profile(openslide_t *osr,
                                                  const char *name,
                                                  void *dest) {
-  struct _openslide_associated_image *img =
-    g_hash_table_lookup(osr->associated_images, name);
-  if (!img) {
+  const struct _openslide_associated_image *info =
+    get_associated_image_info(osr, name);
+  if (!info) {
     return;
   }
+  int64_t size = info->icc_profile_size;
 
   if (openslide_get_error(osr)) {
-    memset(dest, 0, img->icc_profile_size);
+    memset(dest, 0, size);
+    return;
+  }
+  if (!size) {
     return;
   }
-  if (!img->icc_profile_size) {
+  if (!backend_acquire(osr)) {
+    memset(dest, 0, size);
     return;
   }
+  struct _openslide_associated_image *img =
+    g_hash_table_lookup(osr->associated_images, name);
   g_assert(img->ops->read_icc_profile);
 
   GError *tmp_err = NULL;
-  if (!img->ops->read_icc_profile(img, dest, &tmp_err)) {
+  bool ok = img->ops->read_icc_profile(img, dest, &tmp_err);
+  backend_release(osr);
+  if (!ok) {
     _openslide_propagate_error(osr, tmp_err);
-    memset(dest, 0, img->icc_profile_size);
+    memset(dest, 0, size);
   }
 }
 
@@ -694,6 +1194,98 @@ void openslide_cache_release(openslide_cache_t *cache) {
   _openslide_cache_release(cache);
 }
 
+void openslide_cache_get_stats(openslide_cache_t *cache,
+                               int64_t *hits, int64_t *misses) {
+  uint64_t h, m;
+  _openslide_cache_get_stats(cache, &h, &m);
+  *hits = h;
+  *misses = m;
+}
+
+openslide_handle_pool_t *openslide_handle_pool_create(int32_t max_open) {
+  g_return_val_if_fail(max_open > 0, NULL);
+  return _openslide_handle_pool_create(max_open);
+}
+
+void openslide_set_handle_pool(openslide_t *osr,
+                               openslide_handle_pool_t *pool) {
+  if (openslide_get_error(osr)) {
+    return;
+  }
+
+  g_rw_lock_writer_lock(&osr->backend_lock);
+  openslide_handle_pool_t *old = osr->pool;
+  if (old) {
+    _openslide_handle_pool_remove(old, osr);
+  }
+  if (pool) {
+    _openslide_handle_pool_ref(pool);
+  }
+  osr->pool = pool;
+  g_rw_lock_writer_unlock(&osr->backend_lock);
+  if (old) {
+    _openslide_handle_pool_unref(old);
+  }
+
+  // count an open backend against the new pool
+  if (pool) {
+    g_rw_lock_reader_lock(&osr->backend_lock);
+    if (!osr->parked) {
+      _openslide_handle_pool_touch(pool, osr);
+    }
+    g_rw_lock_reader_unlock(&osr->backend_lock);
+  }
+}
+
+void openslide_handle_pool_release(openslide_handle_pool_t *pool) {
+  _openslide_handle_pool_release(pool);
+}
+
+static uint64_t string_table_size(GHashTable *ht) {
+  uint64_t total = _openslide_hash_table_overhead(ht) +
+    (g_hash_table_size(ht) + 1) * sizeof(char *);  // names array
+  GHashTableIter iter;
+  void *key;
+  g_hash_table_iter_init(&iter, ht);
+  while (g_hash_table_iter_next(&iter, &key, NULL)) {
+    total += strlen(key) + 1;
+  }
+  return total;
+}
+
+int64_t openslide_get_memory_usage(openslide_t *osr) {
+  if (openslide_get_error(osr)) {
+    return -1;
+  }
+
+  uint64_t total = sizeof(*osr);
+
+  total += string_table_size(osr->properties);
+  GHashTableIter iter;
+  void *value;
+  g_hash_table_iter_init(&iter, osr->properties);
+  while (g_hash_table_iter_next(&iter, NULL, &value)) {
+    total += strlen(value) + 1;
+  }
+
+  total += osr->level_count * sizeof(struct _openslide_level);
+
+  // the pool may park the backend, which swaps the associated images
+  g_rw_lock_reader_lock(&osr->backend_lock);
+  // images and their geometry copies
+  total += string_table_size(osr->associated_images) +
+    g_hash_table_size(osr->associated_images) * 2 *
+    sizeof(struct _openslide_associated_image);
+  if (osr->ops->get_memory_usage) {
+    total += osr->ops->get_memory_usage(osr);
+  }
+  g_rw_lock_reader_unlock(&osr->backend_lock);
+  if (osr->cache) {
+    total += _openslide_cache_binding_get_size(osr->cache);
+  }
+  return total;
+}
+
 const char *openslide_get_version(void) {
   return SUFFIXED_VERSION;
 }
@@ -59,6 +59,15 @@ typedef struct _openslide openslide_t;
  */
 typedef struct _openslide_cache openslide_cache_t;
 
+/**
+ * A pool limiting the number of OpenSlide objects with open files.
+ *
+ * An @ref openslide_handle_pool_t object can be used concurrently from
+ * multiple threads without locking.  (But you must lock or otherwise use
+ * memory barriers when passing the object between threads.)
+ */
+typedef struct _openslide_handle_pool openslide_handle_pool_t;
+
 
 /**
  * @name Basic Usage
@@ -202,6 +211,63 @@ void openslide_read_region(openslide_t *osr,
 			   int64_t w, int64_t h);
 
 
+/**
+ * A callback that receives one band of a region read by
+ * openslide_read_region_stream().
+ *
+ * @param buf Pre-multiplied ARGB data for @p h rows of the region, each
+ * (@p w * 4) bytes long.  The buffer is owned by OpenSlide and is only
+ * valid until the callback returns.
+ * @param row The first row of the band, relative to the top of the region.
+ * @param h The number of rows in the band.
+ * @param user_data The @p user_data passed to openslide_read_region_stream().
+ * @return true to continue reading, or false to stop.
+ * @since 4.1.0
+ */
+typedef bool (*openslide_band_callback)(const uint32_t *buf,
+                                        int64_t row, int64_t h,
+                                        void *user_data);
+
+/**
+ * Read a region of a whole slide image as a sequence of horizontal bands.
+ *
+ * This function reads the same pixels as openslide_read_region(), but
+ * delivers them to @p callback in bands of @p band_h rows, from top to
+ * bottom, through a buffer reused for every band.  The last band may be
+ * shorter.  Internally the region is read in rows of native tiles, so each
+ * tile is decoded once no matter how the bands fall, and only about
+ * (@p w * (@p band_h + tile height) * 4) bytes are needed at a time.
+ *
+ * Levels without uniform tile geometry, which have no
+ * openslide.level[N].tile-height property, are read in strips aligned to
+ * multiples of 256 rows instead.  Tiles crossing a strip boundary are then painted into both
+ * strips and may be decoded twice if they are evicted from the cache in
+ * between.
+ *
+ * If an error occurs or has occurred, no further bands are delivered.
+ * Check for errors with openslide_get_error().
+ *
+ * @param osr The OpenSlide object.
+ * @param x The top left x-coordinate, in the level 0 reference frame.
+ * @param y The top left y-coordinate, in the level 0 reference frame.
+ * @param level The desired level.
+ * @param w The width of the region. Must be non-negative.
+ * @param h The height of the region. Must be non-negative.
+ * @param band_h The height of each band. Must be positive.
+ * @param callback The function to receive each band.
+ * @param user_data Data to pass to @p callback.
+ * @since 4.1.0
+ */
+OPENSLIDE_PUBLIC()
+void openslide_read_region_stream(openslide_t *osr,
+                                  int64_t x, int64_t y,
+                                  int32_t level,
+                                  int64_t w, int64_t h,
+                                  int64_t band_h,
+                                  openslide_band_callback callback,
+                                  void *user_data);
+
+
 /**
  * Get the size in bytes of the ICC color profile for the whole slide image.
  *
@@ -231,6 +297,27 @@ OPENSLIDE_PUBLIC()
 void openslide_read_icc_profile(openslide_t *osr, void *dest);
 
 
+/**
+ * Get the approximate memory used by an OpenSlide object.
+ *
+ * The total includes properties, the backend's index structures such as
+ * tile maps and pooled file handles, and the bytes of tiles in the cache
+ * that were inserted by this object.  If the cache is shared, tiles
+ * inserted by other objects are not counted.  Memory is estimated rather
+ * than measured, so the result is useful for comparing objects and for
+ * deciding which to close, not for exact accounting.
+ *
+ * This function may be called while other threads are reading from the
+ * object.
+ *
+ * @param osr The OpenSlide object.
+ * @return The estimated size in bytes, or -1 if an error occurred.
+ * @since 4.1.0
+ */
+OPENSLIDE_PUBLIC()
+int64_t openslide_get_memory_usage(openslide_t *osr);
+
+
 /**
  * Close an OpenSlide object.
  * No other threads may be using the object.
@@ -378,6 +465,27 @@ const char *openslide_get_error(openslide_t *osr);
  */
 #define OPENSLIDE_PROPERTY_NAME_QUICKHASH1 "openslide.quickhash-1"
 
+/**
+ * The name of the property containing the "quickhash-2" sum.
+ *
+ * quickhash-2 covers the same slide data as quickhash-1, but is also
+ * available for many slides whose lowest-resolution level is too large for
+ * quickhash-1.  For those, it covers the whole level when the hashed data
+ * stays within 64 MiB.  Otherwise it covers an evenly spaced sample of the
+ * level's tiles or strips of bounded total size, together with the
+ * sampling stride and the level's total size, so it is still quick to
+ * compute.  A sampled value is not unique to the slide's contents: slides
+ * that differ only in tiles outside the sample have the same value.
+ *
+ * It is a tree hash: the SHA-256 of the SHA-256 digests of each
+ * consecutive 1 MiB of the hashed data, followed by the data length in
+ * bytes as a 64-bit little-endian integer.  It is omitted if the hashed
+ * data would exceed 64 MiB.
+ *
+ * @since 4.1.0
+ */
+#define OPENSLIDE_PROPERTY_NAME_QUICKHASH2 "openslide.quickhash-2"
+
 /**
  * The name of the property containing an identification of the vendor.
  *
@@ -588,6 +696,80 @@ void openslide_set_cache(openslide_t *osr, openslide_cache_t *cache);
 OPENSLIDE_PUBLIC()
 void openslide_cache_release(openslide_cache_t *cache);
 
+/**
+ * Get lookup statistics for the cache.  Every tile lookup by an attached
+ * OpenSlide object counts as either a hit or a miss.  The counts start at
+ * zero when the cache is created.
+ *
+ * @param cache The cache.
+ * @param[out] hits The number of lookups that found the tile in the cache.
+ * @param[out] misses The number of lookups that did not.
+ * @since 4.1.0
+ */
+OPENSLIDE_PUBLIC()
+void openslide_cache_get_stats(openslide_cache_t *cache,
+                               int64_t *hits, int64_t *misses);
+
+//@}
+
+/**
+ * @name Handle Pools
+ * Limiting open files and backend memory across many slides.
+ *
+ * A server with thousands of open OpenSlide objects can run out of file
+ * descriptors or memory, since each object keeps its slide's files and
+ * decoder state open.  OpenSlide objects attached to a handle pool share
+ * a limit on the number of objects with an open backend.  When the limit
+ * is exceeded, the least recently used idle objects are parked: their
+ * files are closed and their backend state is freed, but properties,
+ * level and associated image metadata, and tile cache settings are kept.
+ * A parked object is reopened automatically the next time it reads
+ * pixel or ICC profile data, at about the cost of openslide_open().  If
+ * the slide file has changed or can no longer be opened, the object is
+ * put into error state.
+ */
+//@{
+
+/**
+ * Create a new handle pool, unconnected to any OpenSlide object.  The pool
+ * can be attached to one or more OpenSlide objects with
+ * openslide_set_handle_pool().  The pool must be released with
+ * openslide_handle_pool_release() when done.
+ *
+ * Objects in use by another thread are never parked, so the number of
+ * open objects can briefly exceed the limit.
+ *
+ * @param max_open The maximum number of attached OpenSlide objects with an
+ *                 open backend.  Must be positive.
+ * @return A new handle pool.
+ * @since 4.1.0
+ */
+OPENSLIDE_PUBLIC()
+openslide_handle_pool_t *openslide_handle_pool_create(int32_t max_open);
+
+/**
+ * Attach a handle pool to the specified OpenSlide object, replacing the
+ * current pool, if any.
+ *
+ * @param osr The OpenSlide object.
+ * @param pool The pool to attach, or NULL to detach the current pool.
+ * @since 4.1.0
+ */
+OPENSLIDE_PUBLIC()
+void openslide_set_handle_pool(openslide_t *osr,
+                               openslide_handle_pool_t *pool);
+
+/**
+ * Release the handle pool.  The pool may be released while it is still
+ * attached to OpenSlide objects.  It will be freed once the last attached
+ * OpenSlide object is closed.
+ *
+ * @param pool The pool to release.
+ * @since 4.1.0
+ */
+OPENSLIDE_PUBLIC()
+void openslide_handle_pool_release(openslide_handle_pool_t *pool);
+
 //@}
 
 /**
@@ -0,0 +1,335 @@
+/*
+ *  OpenSlide, a library for reading whole slide image files
+ *
+ *  Copyright (c) 2026 OpenSlide contributors
+ *  All rights reserved.
+ *
+ *  OpenSlide is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation, version 2.1.
+ *
+ *  OpenSlide is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with OpenSlide. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Benchmark suites over parameterized synthetic slides.  Requires
+   OPENSLIDE_DEBUG=synthetic.  Results are printed to stdout as JSON. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <glib.h>
+#include <openslide.h>
+#include "openslide-common.h"
+
+#define MiB (1024 * 1024)
+#define SEED 42
+
+struct bench {
+  GString *json;
+  bool first;
+};
+
+struct job {
+  openslide_t *osr;
+  int32_t level;
+  int64_t level_w;
+  int64_t level_h;
+  int32_t region_w;
+  int32_t region_h;
+  int64_t ops;
+  uint32_t seed;
+};
+
+static openslide_t *open_spec(const char *spec, size_t cache_size) {
+  openslide_t *osr = openslide_open(spec);
+  if (!osr) {
+    common_fail("Couldn't open %s; is OPENSLIDE_DEBUG=synthetic set?", spec);
+  }
+  common_fail_on_error(osr, "Opening %s", spec);
+  openslide_cache_t *cache = openslide_cache_create(cache_size);
+  openslide_set_cache(osr, cache);
+  openslide_cache_release(cache);
+  return osr;
+}
+
+static void report(struct bench *b, const char *suite, const char *name,
+                   int threads, int64_t ops, int64_t pixels,
+                   double seconds) {
+  g_string_append_printf(b->json,
+                         "%s\n    {\"suite\": \"%s\", \"name\": \"%s\", "
+                         "\"threads\": %d, \"ops\": %"PRId64", "
+                         "\"seconds\": %.6f, \"ops_per_sec\": %.1f, "
+                         "\"mpixels_per_sec\": %.2f}",
+                         b->first ? "" : ",", suite, name, threads, ops,
+                         seconds, ops / seconds, pixels / seconds / 1e6);
+  b->first = false;
+  // progress
+  fprintf(stderr, "%s/%s (%d threads): %.1f ops/s\n",
+          suite, name, threads, ops / seconds);
+}
+
+static void report_skipped(struct bench *b, const char *suite,
+                           const char *name, const char *reason) {
+  g_string_append_printf(b->json,
+                         "%s\n    {\"suite\": \"%s\", \"name\": \"%s\", "
+                         "\"skipped\": \"%s\"}",
+                         b->first ? "" : ",", suite, name, reason);
+  b->first = false;
+  fprintf(stderr, "%s/%s: skipped, %s\n", suite, name, reason);
+}
+
+static void read_all_tiles(openslide_t *osr, int32_t level, int32_t tile) {
+  int64_t w, h;
+  openslide_get_level_dimensions(osr, level, &w, &h);
+  double downsample = openslide_get_level_downsample(osr, level);
+  g_autofree uint32_t *buf = g_new(uint32_t, (int64_t) tile * tile);
+  for (int64_t y = 0; y < h; y += tile) {
+    for (int64_t x = 0; x < w; x += tile) {
+      openslide_read_region(osr, buf, x * downsample, y * downsample, level,
+                            tile, tile);
+    }
+  }
+  common_fail_on_error(osr, "Reading tiles");
+}
+
+// read random regions
+static void *random_reads(void *data) {
+  struct job *job = data;
+  g_autoptr(GRand) rand = g_rand_new_with_seed(job->seed);
+  g_autofree uint32_t *buf =
+    g_new(uint32_t, (int64_t) job->region_w * job->region_h);
+  double downsample = openslide_get_level_downsample(job->osr, job->level);
+  for (int64_t i = 0; i < job->ops; i++) {
+    // g_rand_int_range() takes 32-bit bounds
+    int64_t x = g_rand_double_range(rand, 0,
+                                    MAX(job->level_w - job->region_w, 1));
+    int64_t y = g_rand_double_range(rand, 0,
+                                    MAX(job->level_h - job->region_h, 1));
+    openslide_read_region(job->osr, buf,
+                          x * downsample, y * downsample, job->level,
+                          job->region_w, job->region_h);
+  }
+  return NULL;
+}
+
+// run total_ops random reads split across threads; return elapsed seconds
+static double run_random_reads(openslide_t *osr, int32_t level,
+                               int32_t region_w, int32_t region_h,
+                               int threads, int64_t total_ops) {
+  int64_t w, h;
+  openslide_get_level_dimensions(osr, level, &w, &h);
+  g_autofree struct job *jobs = g_new(struct job, threads);
+  g_autofree GThread **workers = g_new(GThread *, threads);
+  g_autoptr(GTimer) timer = g_timer_new();
+  for (int i = 0; i < threads; i++) {
+    jobs[i] = (struct job) {
+      .osr = osr,
+      .level = level,
+      .level_w = w,
+      .level_h = h,
+      .region_w = region_w,
+      .region_h = region_h,
+      .ops = total_ops / threads,
+      .seed = SEED + i,
+    };
+    workers[i] = g_thread_new("bench", random_reads, &jobs[i]);
+  }
+  for (int i = 0; i < threads; i++) {
+    g_thread_join(workers[i]);
+  }
+  double seconds = g_timer_elapsed(timer, NULL);
+  common_fail_on_error(osr, "Reading regions");
+  return seconds;
+}
+
+// tile decode throughput per codec, with caching disabled
+static void bench_decode(struct bench *b) {
+  const char *codecs[] = {"none", "jpeg", "png", "j2k", "zstd"};
+  const int32_t tile = 256;
+  const int passes = 4;
+  for (unsigned i = 0; i < G_N_ELEMENTS(codecs); i++) {
+    g_autofree char *spec =
+      g_strdup_printf("synthetic://w=2048,h=2048,tile=%d,codec=%s",
+                      tile, codecs[i]);
+    g_autoptr(openslide_t) osr = open_spec(spec, 0);
+    g_autoptr(GTimer) timer = g_timer_new();
+    for (int pass = 0; pass < passes; pass++) {
+      read_all_tiles(osr, 0, tile);
+    }
+    int64_t ops = passes * (2048 / tile) * (2048 / tile);
+    report(b, "decode", codecs[i], 1, ops, ops * tile * tile,
+           g_timer_elapsed(timer, NULL));
+  }
+  // OpenSlide only links a JPEG XR decoder, so there's nothing to
+  // generate synthetic tiles with
+  report_skipped(b, "decode", "jxr", "no JPEG XR encoder");
+}
+
+// cache lookups from many threads: small reads from a fully cached slide,
+// then from a slide 16 times larger than the cache, so threads insert and
+// evict concurrently
+static void bench_cache(struct bench *b) {
+  const int32_t tile = 256;
+  const int64_t ops = 64000;
+  g_autoptr(openslide_t) osr =
+    open_spec("synthetic://w=2048,h=2048,tile=256,codec=none", 64 * MiB);
+  read_all_tiles(osr, 0, tile);
+  for (int threads = 1; threads <= 64; threads *= 2) {
+    double seconds = run_random_reads(osr, 0, 16, 16, threads, ops);
+    report(b, "cache", "hit-16x16", threads, ops, ops * 16 * 16, seconds);
+  }
+
+  const int64_t evict_ops = 16000;
+  g_autoptr(openslide_t) evict_osr =
+    open_spec("synthetic://w=8192,h=8192,tile=256,codec=none", 16 * MiB);
+  for (int threads = 1; threads <= 64; threads *= 2) {
+    double seconds = run_random_reads(evict_osr, 0, 16, 16, threads,
+                                      evict_ops);
+    report(b, "cache", "evict-16x16", threads, evict_ops,
+           evict_ops * 16 * 16, seconds);
+  }
+}
+
+// unaligned reads from a fully cached slide, for each grid type
+static void bench_grid(struct bench *b) {
+  const char *grids[] = {"simple", "tilemap", "range"};
+  const int64_t ops = 1000;
+  for (unsigned i = 0; i < G_N_ELEMENTS(grids); i++) {
+    g_autofree char *spec =
+      g_strdup_printf("synthetic://w=4096,h=4096,tile=256,codec=none,"
+                      "grid=%s", grids[i]);
+    g_autoptr(openslide_t) osr = open_spec(spec, 128 * MiB);
+    read_all_tiles(osr, 0, 256);
+    double seconds = run_random_reads(osr, 0, 512, 512, 1, ops);
+    report(b, "grid", grids[i], 1, ops, ops * 512 * 512, seconds);
+  }
+}
+
+// end-to-end reads with typical viewer and analysis access patterns
+static void bench_read_region(struct bench *b) {
+  const char *spec =
+    "synthetic://w=32768,h=32768,tile=256,codec=jpeg,levels=4";
+  const int32_t vw = 1024;
+  const int32_t vh = 768;
+  g_autofree uint32_t *buf = g_new(uint32_t, (int64_t) vw * vh);
+
+  // sequential: raster scan of a window at level 0
+  {
+    g_autoptr(openslide_t) osr = open_spec(spec, 64 * MiB);
+    g_autoptr(GTimer) timer = g_timer_new();
+    int64_t ops = 0;
+    for (int64_t y = 0; y < 8192; y += vh) {
+      for (int64_t x = 0; x < 8192; x += vw) {
+        openslide_read_region(osr, buf, x, y, 0, vw, vh);
+        ops++;
+      }
+    }
+    common_fail_on_error(osr, "Reading regions");
+    report(b, "read-region", "sequential", 1, ops, ops * vw * vh,
+           g_timer_elapsed(timer, NULL));
+  }
+
+  // random: scattered reads at level 0, 1 and 8 threads
+  for (int threads = 1; threads <= 8; threads *= 8) {
+    g_autoptr(openslide_t) osr = open_spec(spec, 64 * MiB);
+    const int64_t ops = 256;
+    double seconds = run_random_reads(osr, 0, 512, 512, threads, ops);
+    report(b, "read-region", "random", threads, ops, ops * 512 * 512,
+           seconds);
+  }
+
+  // pan: viewport sliding right and down in small steps
+  {
+    g_autoptr(openslide_t) osr = open_spec(spec, 64 * MiB);
+    g_autoptr(GTimer) timer = g_timer_new();
+    const int64_t ops = 256;
+    for (int64_t i = 0; i < ops; i++) {
+      openslide_read_region(osr, buf, i * 64, i * 16, 0, vw, vh);
+    }
+    common_fail_on_error(osr, "Reading regions");
+    report(b, "read-region", "pan", 1, ops, ops * vw * vh,
+           g_timer_elapsed(timer, NULL));
+  }
+
+  // zoom: viewport centered on one point, stepping through the levels
+  {
+    g_autoptr(openslide_t) osr = open_spec(spec, 64 * MiB);
+    int32_t levels = openslide_get_level_count(osr);
+    g_autoptr(GTimer) timer = g_timer_new();
+    const int64_t cycles = 16;
+    int64_t ops = 0;
+    for (int64_t i = 0; i < cycles; i++) {
+      // move the center each cycle, so levels are not just cache hits
+      int64_t cx = 4096 + i * 1024;
+      int64_t cy = 4096 + i * 1024;
+      for (int32_t level = levels - 1; level >= 0; level--) {
+        double downsample = openslide_get_level_downsample(osr, level);
+        openslide_read_region(osr, buf,
+                              cx - vw / 2 * downsample,
+                              cy - vh / 2 * downsample,
+                              level, vw, vh);
+        ops++;
+      }
+    }
+    common_fail_on_error(osr, "Reading regions");
+    report(b, "read-region", "zoom", 1, ops, ops * vw * vh,
+           g_timer_elapsed(timer, NULL));
+  }
+}
+
+static const struct suite {
+  const char *name;
+  void (*run)(struct bench *b);
+} suites[] = {
+  {"decode", bench_decode},
+  {"cache", bench_cache},
+  {"grid", bench_grid},
+  {"read-region", bench_read_region},
+};
+
+int main(int argc, char **argv) {
+  common_fix_argv(&argc, &argv);
+
+  struct bench b = {
+    .json = g_string_new("{\n  \"openslide_version\": "),
+    .first = true,
+  };
+  g_string_append_printf(b.json, "\"%s\",\n  \"results\": [",
+                         openslide_get_version());
+
+  for (int j = 1; j < argc; j++) {
+    bool known = false;
+    for (unsigned i = 0; i < G_N_ELEMENTS(suites); i++) {
+      known = known || g_str_equal(argv[j], suites[i].name);
+    }
+    if (!known) {
+      common_fail("Unknown suite: %s", argv[j]);
+    }
+  }
+
+  // run the named suites, or all of them
+  for (unsigned i = 0; i < G_N_ELEMENTS(suites); i++) {
+    bool selected = argc < 2;
+    for (int j = 1; j < argc; j++) {
+      selected = selected || g_str_equal(argv[j], suites[i].name);
+    }
+    if (selected) {
+      suites[i].run(&b);
+    }
+  }
+
+  g_string_append(b.json, "\n  ]\n}\n");
+  fputs(b.json->str, stdout);
+  g_string_free(b.json, true);
+  return 0;
+}
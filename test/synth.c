@@ -24,11 +24,32 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <glib.h>
 #include <openslide.h>
 
 #include "openslide-common.h"
 
+struct stream_check {
+  uint32_t *expected;
+  int64_t rows;
+  bool ok;
+};
+
+static bool check_band(const uint32_t *buf, int64_t row, int64_t h,
+                       void *data) {
+  struct stream_check *check = data;
+  if (row == 0) {
+    check->ok = true;
+  }
+  if (row != check->rows || h > 100 ||
+      memcmp(buf, check->expected + row * 1000, h * 1000 * 4)) {
+    check->ok = false;
+  }
+  check->rows += h;
+  return true;
+}
+
 int main(int argc, char **argv) {
   common_fix_argv(&argc, &argv);
   if (argc < 2 || !g_str_equal(argv[1], "child")) {
@@ -58,6 +79,186 @@ int main(int argc, char **argv) {
   openslide_read_region(osr, buf, 0, 0, 0, 1000, 100);
   common_fail_on_error(osr, "Reading region");
 
+  // parameterized synthetic slide, one per codec and grid
+  const char *const specs[] = {
+    "synthetic://w=1000,h=700,tile=128,codec=none,levels=3",
+    "synthetic://w=1000,h=700,tile=128,codec=jpeg,levels=3",
+    "synthetic://w=1000,h=700,tile=128,codec=png,levels=3",
+    "synthetic://w=1000,h=700,tile=128,codec=j2k,levels=3",
+    "synthetic://w=1000,h=700,tile=128,codec=zstd,levels=3",
+    "synthetic://w=1000,h=700,tile=128,codec=none,levels=3,grid=tilemap",
+    "synthetic://w=1000,h=700,tile=128,codec=none,levels=3,grid=range",
+  };
+  for (unsigned i = 0; i < G_N_ELEMENTS(specs); i++) {
+    g_autoptr(openslide_t) slide = openslide_open(specs[i]);
+    common_fail_on_error(slide, "Opening %s", specs[i]);
+    if (openslide_get_level_count(slide) != 3) {
+      common_fail("Wrong level count for %s", specs[i]);
+    }
+    int64_t w, h;
+    openslide_get_level_dimensions(slide, 2, &w, &h);
+    if (w != 250 || h != 175) {
+      common_fail("Wrong level 2 dimensions for %s", specs[i]);
+    }
+    openslide_read_region(slide, buf, 900, 600, 0, 1000, 100);
+    common_fail_on_error(slide, "Reading region from %s", specs[i]);
+    openslide_read_region(slide, buf, 0, 0, 2, 250, 100);
+    common_fail_on_error(slide, "Reading level 2 from %s", specs[i]);
+  }
+
+  // cache statistics
+  {
+    g_autoptr(openslide_t) slide =
+      openslide_open("synthetic://w=512,h=512,tile=256,codec=none");
+    common_fail_on_error(slide, "Opening slide for cache test");
+    openslide_cache_t *cache = openslide_cache_create(16 << 20);
+    openslide_set_cache(slide, cache);
+    int64_t hits, misses;
+    openslide_read_region(slide, buf, 0, 0, 0, 256, 256);
+    openslide_cache_get_stats(cache, &hits, &misses);
+    if (hits != 0 || misses != 1) {
+      common_fail("Unexpected cache stats after first read: "
+                  "%"PRId64" hits, %"PRId64" misses", hits, misses);
+    }
+    openslide_read_region(slide, buf, 0, 0, 0, 256, 256);
+    openslide_cache_get_stats(cache, &hits, &misses);
+    if (hits != 1 || misses != 1) {
+      common_fail("Unexpected cache stats after second read: "
+                  "%"PRId64" hits, %"PRId64" misses", hits, misses);
+    }
+    openslide_cache_release(cache);
+    common_fail_on_error(slide, "Reading for cache test");
+  }
+
+  // memory usage includes the handle's cached tiles
+  {
+    const char *spec = "synthetic://w=512,h=512,tile=256,codec=none,grid=range";
+    g_autoptr(openslide_t) slide = openslide_open(spec);
+    common_fail_on_error(slide, "Opening %s", spec);
+    g_autoptr(openslide_t) other = openslide_open(spec);
+    common_fail_on_error(other, "Opening %s", spec);
+    openslide_cache_t *cache = openslide_cache_create(16 << 20);
+    openslide_set_cache(slide, cache);
+    openslide_set_cache(other, cache);
+    int64_t before = openslide_get_memory_usage(slide);
+    if (before <= 0) {
+      common_fail("Bad memory usage: %"PRId64, before);
+    }
+    openslide_read_region(other, buf, 0, 0, 0, 256, 256);
+    if (openslide_get_memory_usage(slide) != before) {
+      common_fail("Memory usage includes another handle's tiles");
+    }
+    openslide_read_region(slide, buf, 0, 0, 0, 256, 256);
+    int64_t after = openslide_get_memory_usage(slide);
+    if (after - before != 256 * 256 * 4) {
+      common_fail("Memory usage grew by %"PRId64" bytes, expected %d",
+                  after - before, 256 * 256 * 4);
+    }
+    openslide_cache_release(cache);
+    common_fail_on_error(slide, "Reading for memory usage test");
+  }
+
+  // streamed reads match whole reads and decode each tile once
+  {
+    g_autoptr(openslide_t) slide =
+      openslide_open("synthetic://w=1000,h=700,tile=128,codec=png");
+    common_fail_on_error(slide, "Opening slide for stream test");
+    openslide_cache_t *cache = openslide_cache_create(0);
+    openslide_set_cache(slide, cache);
+    struct stream_check check = {
+      .expected = g_malloc(4 * 1000 * 700),
+    };
+    openslide_read_region(slide, check.expected, 0, 0, 0, 1000, 700);
+    int64_t hits, misses;
+    openslide_cache_get_stats(cache, &hits, &misses);
+    int64_t whole_misses = misses;
+    openslide_read_region_stream(slide, 0, 0, 0, 1000, 700, 100,
+                                 check_band, &check);
+    common_fail_on_error(slide, "Streaming region");
+    openslide_cache_get_stats(cache, &hits, &misses);
+    openslide_cache_release(cache);
+    if (!check.ok || check.rows != 700) {
+      common_fail("Streamed region differs from whole region");
+    }
+    if (misses - whole_misses != 8 * 6) {
+      common_fail("Streaming decoded %"PRId64" tiles, expected %d",
+                  misses - whole_misses, 8 * 6);
+    }
+    g_free(check.expected);
+  }
+
+  // pooled handles are parked when idle and reopened transparently
+  {
+    const char *spec = "synthetic://w=1000,h=700,tile=128,codec=png,levels=3";
+    g_autoptr(openslide_t) slide = openslide_open(spec);
+    common_fail_on_error(slide, "Opening %s", spec);
+    g_autoptr(openslide_t) other = openslide_open(spec);
+    common_fail_on_error(other, "Opening %s", spec);
+    g_autofree uint32_t *expected = g_malloc(4 * 300 * 200);
+    g_autofree uint32_t *actual = g_malloc(4 * 300 * 200);
+    openslide_read_region(slide, expected, 100, 100, 0, 300, 200);
+    int64_t open_usage = openslide_get_memory_usage(slide);
+
+    openslide_handle_pool_t *pool = openslide_handle_pool_create(1);
+    openslide_set_handle_pool(slide, pool);
+    openslide_set_handle_pool(other, pool);
+    openslide_handle_pool_release(pool);
+    for (int i = 0; i < 2; i++) {
+      // reading the other handle parks this one
+      openslide_read_region(other, actual, 0, 0, 0, 300, 200);
+      if (openslide_get_memory_usage(slide) >= open_usage) {
+        common_fail("Idle pooled handle wasn't parked");
+      }
+      int64_t w, h;
+      openslide_get_level_dimensions(slide, 2, &w, &h);
+      if (w != 250 || h != 175) {
+        common_fail("Wrong level 2 dimensions for parked handle");
+      }
+      openslide_read_region(slide, actual, 100, 100, 0, 300, 200);
+      common_fail_on_error(slide, "Reading reopened handle");
+      if (memcmp(expected, actual, 4 * 300 * 200)) {
+        common_fail("Reopened handle read different pixels");
+      }
+    }
+    common_fail_on_error(other, "Reading pooled handle");
+  }
+
+  // tilemap and range grids refuse to enumerate huge tile counts
+  {
+    const char *spec =
+      "synthetic://w=1000000000,h=1000000000,tile=1,codec=none,grid=range";
+    g_autoptr(openslide_t) slide = openslide_open(spec);
+    if (!openslide_get_error(slide)) {
+      common_fail("Opened %s", spec);
+    }
+  }
+
+  // quickhash-2 depends only on slide content
+  {
+    const char *const hash_specs[] = {
+      "synthetic://w=512,h=512,tile=256,codec=none",
+      "synthetic://w=512,h=512,tile=256,codec=none",
+      "synthetic://w=512,h=512,tile=256,codec=png",
+    };
+    g_autoptr(GPtrArray) hashes = g_ptr_array_new_with_free_func(g_free);
+    for (unsigned i = 0; i < G_N_ELEMENTS(hash_specs); i++) {
+      g_autoptr(openslide_t) slide = openslide_open(hash_specs[i]);
+      common_fail_on_error(slide, "Opening %s", hash_specs[i]);
+      const char *hash =
+        openslide_get_property_value(slide, OPENSLIDE_PROPERTY_NAME_QUICKHASH2);
+      if (!hash || strlen(hash) != 64) {
+        common_fail("Missing or malformed quickhash-2 for %s", hash_specs[i]);
+      }
+      g_ptr_array_add(hashes, g_strdup(hash));
+    }
+    if (!g_str_equal(hashes->pdata[0], hashes->pdata[1])) {
+      common_fail("quickhash-2 differs between opens of the same slide");
+    }
+    if (g_str_equal(hashes->pdata[0], hashes->pdata[2])) {
+      common_fail("quickhash-2 is the same for different slides");
+    }
+  }
+
   // report tests
   printf("Tested:\n");
   for (const char *const *prop = openslide_get_property_names(osr);
@@ -0,0 +1,284 @@
+/*
+ *  OpenSlide, a library for reading whole slide image files
+ *
+ *  Copyright (c) 2026 OpenSlide contributors
+ *  All rights reserved.
+ *
+ *  OpenSlide is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation, version 2.1.
+ *
+ *  OpenSlide is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with OpenSlide. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <glib.h>
+#include "openslide.h"
+#include "openslide-common.h"
+#include "slidetool.h"
+
+enum pattern {
+  PATTERN_SEQUENTIAL,
+  PATTERN_RANDOM,
+  PATTERN_WALK,
+};
+
+static const char *const pattern_names[] = {
+  [PATTERN_SEQUENTIAL] = "sequential",
+  [PATTERN_RANDOM] = "random",
+  [PATTERN_WALK] = "walk",
+};
+
+static char *pattern_name;
+static gint threads = 1;
+static gint64 cache_size = 32 << 20;
+static gint level;
+static gint region_size = 512;
+static gdouble duration = 10;
+
+struct worker {
+  openslide_t *osr;
+  enum pattern pattern;
+  int index;
+  int count;
+  int64_t deadline;
+  GArray *latencies;
+};
+
+// current position and level of a reader
+struct cursor {
+  int32_t level;
+  int64_t x;  // level coordinates
+  int64_t y;
+};
+
+static void read_at(struct worker *w, uint32_t *buf, const struct cursor *c) {
+  double ds = openslide_get_level_downsample(w->osr, c->level);
+  int64_t start = g_get_monotonic_time();
+  openslide_read_region(w->osr, buf, c->x * ds, c->y * ds, c->level,
+                        region_size, region_size);
+  int64_t elapsed = g_get_monotonic_time() - start;
+  g_array_append_val(w->latencies, elapsed);
+}
+
+// raster sweep; each worker takes every Nth row of regions
+static void run_sequential(struct worker *w, uint32_t *buf) {
+  int64_t lw, lh;
+  openslide_get_level_dimensions(w->osr, level, &lw, &lh);
+  int64_t across = (lw + region_size - 1) / region_size;
+  int64_t down = (lh + region_size - 1) / region_size;
+  struct cursor c = { .level = level };
+  int64_t row = w->index % down;
+  while (true) {
+    for (int64_t col = 0; col < across; col++) {
+      c.x = col * region_size;
+      c.y = row * region_size;
+      read_at(w, buf, &c);
+      if (g_get_monotonic_time() >= w->deadline) {
+        return;
+      }
+    }
+    row = (row + w->count) % down;
+  }
+}
+
+// regions at random region-aligned positions
+static void run_random(struct worker *w, uint32_t *buf, GRand *rand) {
+  int64_t lw, lh;
+  openslide_get_level_dimensions(w->osr, level, &lw, &lh);
+  int64_t across = (lw + region_size - 1) / region_size;
+  int64_t down = (lh + region_size - 1) / region_size;
+  struct cursor c = { .level = level };
+  while (g_get_monotonic_time() < w->deadline) {
+    c.x = g_rand_int_range(rand, 0, MIN(across, G_MAXINT32)) *
+          (int64_t) region_size;
+    c.y = g_rand_int_range(rand, 0, MIN(down, G_MAXINT32)) *
+          (int64_t) region_size;
+    read_at(w, buf, &c);
+  }
+}
+
+// viewer-like walk: mostly short pans, sometimes zooming one level in or
+// out around the viewport center
+static void run_walk(struct worker *w, uint32_t *buf, GRand *rand) {
+  int32_t levels = openslide_get_level_count(w->osr);
+  int64_t lw, lh;
+  openslide_get_level_dimensions(w->osr, level, &lw, &lh);
+  struct cursor c = {
+    .level = level,
+    .x = g_rand_double(rand) * MAX(lw - region_size, 0),
+    .y = g_rand_double(rand) * MAX(lh - region_size, 0),
+  };
+  while (g_get_monotonic_time() < w->deadline) {
+    read_at(w, buf, &c);
+
+    if (levels > 1 && g_rand_int_range(rand, 0, 4) == 0) {
+      // zoom
+      int32_t new_level = c.level + (g_rand_boolean(rand) ? 1 : -1);
+      new_level = CLAMP(new_level, 0, levels - 1);
+      double scale =
+        openslide_get_level_downsample(w->osr, c.level) /
+        openslide_get_level_downsample(w->osr, new_level);
+      c.x = (c.x + region_size / 2) * scale - region_size / 2;
+      c.y = (c.y + region_size / 2) * scale - region_size / 2;
+      c.level = new_level;
+    } else {
+      // pan by a quarter to half of the viewport
+      int32_t step = region_size / 4 + g_rand_int_range(rand, 0,
+                                                        region_size / 4 + 1);
+      switch (g_rand_int_range(rand, 0, 4)) {
+      case 0: c.x += step; break;
+      case 1: c.x -= step; break;
+      case 2: c.y += step; break;
+      case 3: c.y -= step; break;
+      }
+    }
+
+    // stay inside the level
+    openslide_get_level_dimensions(w->osr, c.level, &lw, &lh);
+    c.x = CLAMP(c.x, 0, MAX(lw - region_size, 0));
+    c.y = CLAMP(c.y, 0, MAX(lh - region_size, 0));
+  }
+}
+
+static void *run_worker(void *data) {
+  struct worker *w = data;
+  g_autofree uint32_t *buf =
+    g_malloc((int64_t) region_size * region_size * 4);
+  g_autoptr(GRand) rand = g_rand_new_with_seed(w->index);
+  switch (w->pattern) {
+  case PATTERN_SEQUENTIAL:
+    run_sequential(w, buf);
+    break;
+  case PATTERN_RANDOM:
+    run_random(w, buf, rand);
+    break;
+  case PATTERN_WALK:
+    run_walk(w, buf, rand);
+    break;
+  }
+  return NULL;
+}
+
+static int do_bench(int narg G_GNUC_UNUSED, char **args) {
+  const char *file = args[0];
+
+  enum pattern pattern = PATTERN_RANDOM;
+  if (pattern_name) {
+    bool found = false;
+    for (unsigned i = 0; i < G_N_ELEMENTS(pattern_names); i++) {
+      if (g_str_equal(pattern_name, pattern_names[i])) {
+        pattern = i;
+        found = true;
+      }
+    }
+    if (!found) {
+      common_fail("Unknown access pattern: %s", pattern_name);
+    }
+  }
+  if (threads < 1) {
+    common_fail("Thread count must be positive");
+  }
+  if (cache_size < 0) {
+    common_fail("Cache size cannot be negative");
+  }
+  if (region_size < 1) {
+    common_fail("Region size must be positive");
+  }
+  if (duration <= 0) {
+    common_fail("Duration must be positive");
+  }
+
+  g_autoptr(openslide_t) osr = openslide_open(file);
+  if (common_warn_on_error(osr, "%s", file)) {
+    return 1;
+  }
+  if (level < 0 || level >= openslide_get_level_count(osr)) {
+    common_fail("%s: No level %d", file, level);
+  }
+  openslide_cache_t *cache = openslide_cache_create(cache_size);
+  openslide_set_cache(osr, cache);
+
+  g_autofree struct worker *workers = g_new0(struct worker, threads);
+  g_autofree GThread **handles = g_new(GThread *, threads);
+  int64_t start = g_get_monotonic_time();
+  for (int i = 0; i < threads; i++) {
+    struct worker *w = &workers[i];
+    w->osr = osr;
+    w->pattern = pattern;
+    w->index = i;
+    w->count = threads;
+    w->deadline = start + duration * G_USEC_PER_SEC;
+    w->latencies = g_array_new(false, false, sizeof(int64_t));
+    handles[i] = g_thread_new("bench", run_worker, w);
+  }
+  g_autoptr(GArray) latencies = g_array_new(false, false, sizeof(int64_t));
+  for (int i = 0; i < threads; i++) {
+    g_thread_join(handles[i]);
+    g_array_append_vals(latencies, workers[i].latencies->data,
+                        workers[i].latencies->len);
+    g_array_unref(workers[i].latencies);
+  }
+  double elapsed = (g_get_monotonic_time() - start) / 1e6;
+
+  int64_t hits, misses;
+  openslide_cache_get_stats(cache, &hits, &misses);
+  openslide_cache_release(cache);
+  if (common_warn_on_error(osr, "%s", file)) {
+    return 1;
+  }
+
+  printf("%s: %s reads of %dx%d starting at level %d, %d threads, "
+         "%"PRId64"-byte cache\n\n", file, pattern_names[pattern],
+         region_size, region_size, level, threads, (int64_t) cache_size);
+  printf("%-24s %u in %.3f s\n", "reads", latencies->len, elapsed);
+  printf("%-24s %.1f reads/s, %.1f Mpixel/s\n", "throughput",
+         latencies->len / elapsed,
+         latencies->len * (double) region_size * region_size / elapsed / 1e6);
+  if (hits + misses) {
+    printf("%-24s %.1f%% of %"PRId64" tile lookups\n", "cache hit rate",
+           100.0 * hits / (hits + misses), hits + misses);
+  }
+  printf("\n");
+  print_latency_header("latency");
+  print_latencies("read_region", latencies);
+  return 0;
+}
+
+static const GOptionEntry bench_opts[] = {
+  {"pattern", 'p', 0, G_OPTION_ARG_STRING, &pattern_name,
+   "Access pattern: sequential, random, or walk (default: random)",
+   "PATTERN"},
+  {"threads", 't', 0, G_OPTION_ARG_INT, &threads,
+   "Reader threads (default: 1)", "COUNT"},
+  {"cache-size", 'c', 0, G_OPTION_ARG_INT64, &cache_size,
+   "Tile cache size in bytes (default: 33554432)", "BYTES"},
+  {"level", 'l', 0, G_OPTION_ARG_INT, &level,
+   "Slide level to read; walks start here (default: 0)", "LEVEL"},
+  {"region-size", 's', 0, G_OPTION_ARG_INT, &region_size,
+   "Width and height of each read (default: 512)", "PIXELS"},
+  {"duration", 'd', 0, G_OPTION_ARG_DOUBLE, &duration,
+   "Run time in seconds (default: 10)", "SECONDS"},
+  {NULL, 0, 0, G_OPTION_ARG_NONE, NULL, NULL, NULL}
+};
+
+const struct command bench_cmd = {
+  .name = "bench",
+  .parameter_string = "<FILE>",
+  .summary = "Benchmark region reads",
+  .description = "Read regions from a slide with a chosen access pattern "
+    "and report throughput, latency percentiles, and cache hit rate.",
+  .options = bench_opts,
+  .min_positional = 1,
+  .max_positional = 1,
+  .handler = do_bench,
+};
@@ -0,0 +1,417 @@
+/*
+ *  OpenSlide, a library for reading whole slide image files
+ *
+ *  Copyright (c) 2026 OpenSlide contributors
+ *  All rights reserved.
+ *
+ *  OpenSlide is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation, version 2.1.
+ *
+ *  OpenSlide is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with OpenSlide. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <math.h>
+#include <glib.h>
+#include <tiffio.h>
+#include <zstd.h>
+#include "openslide.h"
+#include "openslide-common.h"
+#include "slidetool.h"
+
+#define ZSTD_LEVEL 9
+// largest source block read at once, in pixels per side
+#define MAX_BLOCK 2048
+
+static const char SOFTWARE[] = "OpenSlide <https://openslide.org/>";
+
+// copied into ImageDescription
+static const char *const KEY_PROPERTIES[] = {
+  OPENSLIDE_PROPERTY_NAME_VENDOR,
+  OPENSLIDE_PROPERTY_NAME_QUICKHASH1,
+  OPENSLIDE_PROPERTY_NAME_BACKGROUND_COLOR,
+  OPENSLIDE_PROPERTY_NAME_OBJECTIVE_POWER,
+  OPENSLIDE_PROPERTY_NAME_MPP_X,
+  OPENSLIDE_PROPERTY_NAME_MPP_Y,
+};
+
+enum codec {
+  CODEC_JPEG,
+  CODEC_ZSTD,
+};
+
+static const char *const codec_names[] = {
+  [CODEC_JPEG] = "jpeg",
+  [CODEC_ZSTD] = "zstd",
+};
+
+static char *codec_name;
+static gint quality = 90;
+static gint tile_size = 512;
+static gint threads;
+
+struct level_plan {
+  int64_t w;
+  int64_t h;
+  double downsample;
+  int32_t src_level;
+  int32_t factor;  // source pixels per output pixel, per side
+  int64_t across;
+  int64_t down;
+};
+
+struct convert {
+  openslide_t *osr;
+  enum codec codec;
+  uint32_t background;
+  GMutex lock;
+  GCond cond;
+};
+
+struct tile_job {
+  struct convert *conv;
+  const struct level_plan *plan;
+  int64_t tx;
+  int64_t ty;
+  // results, protected by conv->lock
+  GByteArray *data;
+  GError *err;
+  bool done;
+};
+
+// box-filter the source level down to the output level
+static void render_tile(openslide_t *osr, const struct level_plan *plan,
+                        int64_t tx, int64_t ty, uint32_t *tile) {
+  int32_t f = plan->factor;
+  int32_t block = CLAMP(MAX_BLOCK / f, 1, tile_size);
+  g_autofree uint32_t *buf = g_malloc((int64_t) block * f * block * f * 4);
+  uint64_t n = (uint64_t) f * f;
+
+  memset(tile, 0, (int64_t) tile_size * tile_size * 4);
+  for (int32_t by = 0; by < tile_size; by += block) {
+    for (int32_t bx = 0; bx < tile_size; bx += block) {
+      int64_t ox = tx * tile_size + bx;
+      int64_t oy = ty * tile_size + by;
+      if (ox >= plan->w || oy >= plan->h) {
+        continue;
+      }
+      int32_t bw = MIN(block, tile_size - bx);
+      int32_t bh = MIN(block, tile_size - by);
+      int64_t sw = (int64_t) bw * f;
+      openslide_read_region(osr, buf, ox * plan->downsample,
+                            oy * plan->downsample, plan->src_level,
+                            sw, (int64_t) bh * f);
+
+      for (int32_t y = 0; y < bh; y++) {
+        uint32_t *out = tile + (int64_t) (by + y) * tile_size + bx;
+        if (f == 1) {
+          memcpy(out, buf + y * sw, bw * 4);
+          continue;
+        }
+        for (int32_t x = 0; x < bw; x++) {
+          uint64_t sum[4] = {0};
+          for (int32_t sy = 0; sy < f; sy++) {
+            const uint32_t *in = buf + ((int64_t) y * f + sy) * sw +
+                                 (int64_t) x * f;
+            for (int32_t sx = 0; sx < f; sx++) {
+              uint32_t p = in[sx];
+              sum[0] += p >> 24;
+              sum[1] += (p >> 16) & 0xff;
+              sum[2] += (p >> 8) & 0xff;
+              sum[3] += p & 0xff;
+            }
+          }
+          out[x] = (uint32_t) ((sum[0] + n / 2) / n) << 24 |
+                   (uint32_t) ((sum[1] + n / 2) / n) << 16 |
+                   (uint32_t) ((sum[2] + n / 2) / n) << 8 |
+                   (uint32_t) ((sum[3] + n / 2) / n);
+        }
+      }
+    }
+  }
+}
+
+static bool encode_zstd(const uint8_t *rgb, int64_t len, GByteArray *out,
+                        GError **err) {
+  g_byte_array_set_size(out, ZSTD_compressBound(len));
+  size_t rc = ZSTD_compress(out->data, out->len, rgb, len, ZSTD_LEVEL);
+  if (ZSTD_isError(rc)) {
+    g_set_error(err, SLIDETOOL_ERROR, 0, "zstd compression error: %s",
+                ZSTD_getErrorName(rc));
+    return false;
+  }
+  g_byte_array_set_size(out, rc);
+  return true;
+}
+
+static void encode_tile(void *data, void *user_data G_GNUC_UNUSED) {
+  struct tile_job *job = data;
+  struct convert *conv = job->conv;
+  int64_t pixels = (int64_t) tile_size * tile_size;
+  g_autofree uint32_t *argb = g_malloc(pixels * 4);
+  g_autofree uint8_t *rgb = g_malloc(pixels * 3);
+  GByteArray *out = g_byte_array_new();
+  GError *tmp_err = NULL;
+
+  render_tile(conv->osr, job->plan, job->tx, job->ty, argb);
+  // on read errors, the main thread reports the slide's error
+  if (!openslide_get_error(conv->osr)) {
+    argb_to_rgb(rgb, argb, pixels, conv->background);
+    switch (conv->codec) {
+    case CODEC_JPEG:
+      encode_jpeg(rgb, tile_size, tile_size, quality, out, &tmp_err);
+      break;
+    case CODEC_ZSTD:
+      encode_zstd(rgb, pixels * 3, out, &tmp_err);
+      break;
+    }
+  }
+
+  g_mutex_lock(&conv->lock);
+  job->data = out;
+  job->err = tmp_err;
+  job->done = true;
+  g_cond_broadcast(&conv->cond);
+  g_mutex_unlock(&conv->lock);
+}
+
+static GArray *plan_levels(openslide_t *osr) {
+  GArray *plans = g_array_new(false, true, sizeof(struct level_plan));
+  int64_t w0, h0;
+  openslide_get_level0_dimensions(osr, &w0, &h0);
+  for (double ds = 1; ; ds *= 2) {
+    struct level_plan plan = {
+      .w = MAX(ceil(w0 / ds), 1),
+      .h = MAX(ceil(h0 / ds), 1),
+      .downsample = ds,
+    };
+    // tolerate rounding in the slide's downsamples
+    plan.src_level = openslide_get_best_level_for_downsample(osr, ds * 1.01);
+    double src_ds = openslide_get_level_downsample(osr, plan.src_level);
+    plan.factor = MAX(round(ds / src_ds), 1);
+    plan.across = (plan.w + tile_size - 1) / tile_size;
+    plan.down = (plan.h + tile_size - 1) / tile_size;
+    g_array_append_val(plans, plan);
+    if (plan.w <= tile_size && plan.h <= tile_size) {
+      return plans;
+    }
+  }
+}
+
+static char *make_description(openslide_t *osr, const char *slide) {
+  GString *desc = g_string_new(NULL);
+  g_autofree char *base = g_path_get_basename(slide);
+  g_string_append_printf(desc, "Converted by OpenSlide %s from %s\n",
+                         openslide_get_version(), base);
+  for (unsigned i = 0; i < G_N_ELEMENTS(KEY_PROPERTIES); i++) {
+    const char *value = openslide_get_property_value(osr, KEY_PROPERTIES[i]);
+    if (value) {
+      g_string_append_printf(desc, "%s=%s\n", KEY_PROPERTIES[i], value);
+    }
+  }
+  return g_string_free(desc, false);
+}
+
+static void set_tags(TIFF *tiff, struct convert *conv,
+                     const struct level_plan *plan, bool first,
+                     const char *description,
+                     const void *icc, int64_t icc_size) {
+  openslide_t *osr = conv->osr;
+  TIFFSetField(tiff, TIFFTAG_SUBFILETYPE, first ? 0 : FILETYPE_REDUCEDIMAGE);
+  TIFFSetField(tiff, TIFFTAG_IMAGEWIDTH, (uint32_t) plan->w);
+  TIFFSetField(tiff, TIFFTAG_IMAGELENGTH, (uint32_t) plan->h);
+  TIFFSetField(tiff, TIFFTAG_TILEWIDTH, (uint32_t) tile_size);
+  TIFFSetField(tiff, TIFFTAG_TILELENGTH, (uint32_t) tile_size);
+  TIFFSetField(tiff, TIFFTAG_BITSPERSAMPLE, 8);
+  TIFFSetField(tiff, TIFFTAG_SAMPLESPERPIXEL, 3);
+  TIFFSetField(tiff, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+  switch (conv->codec) {
+  case CODEC_JPEG:
+    // each tile is a complete JFIF stream with 2x2 chroma subsampling
+    TIFFSetField(tiff, TIFFTAG_COMPRESSION, COMPRESSION_JPEG);
+    TIFFSetField(tiff, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_YCBCR);
+    TIFFSetField(tiff, TIFFTAG_YCBCRSUBSAMPLING, 2, 2);
+    break;
+  case CODEC_ZSTD:
+    TIFFSetField(tiff, TIFFTAG_COMPRESSION, COMPRESSION_ZSTD);
+    TIFFSetField(tiff, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_RGB);
+    break;
+  }
+  TIFFSetField(tiff, TIFFTAG_SOFTWARE, SOFTWARE);
+
+  const char *mpp_x =
+    openslide_get_property_value(osr, OPENSLIDE_PROPERTY_NAME_MPP_X);
+  const char *mpp_y =
+    openslide_get_property_value(osr, OPENSLIDE_PROPERTY_NAME_MPP_Y);
+  if (mpp_x && mpp_y) {
+    // pixels per centimeter
+    double x = g_ascii_strtod(mpp_x, NULL) * plan->downsample;
+    double y = g_ascii_strtod(mpp_y, NULL) * plan->downsample;
+    if (x > 0 && y > 0) {
+      TIFFSetField(tiff, TIFFTAG_RESOLUTIONUNIT, RESUNIT_CENTIMETER);
+      TIFFSetField(tiff, TIFFTAG_XRESOLUTION, 10000 / x);
+      TIFFSetField(tiff, TIFFTAG_YRESOLUTION, 10000 / y);
+    }
+  }
+
+  if (first) {
+    TIFFSetField(tiff, TIFFTAG_IMAGEDESCRIPTION, description);
+    if (icc_size > 0) {
+      TIFFSetField(tiff, TIFFTAG_ICCPROFILE, (uint32_t) icc_size, icc);
+    }
+  }
+}
+
+// encode tiles in parallel, but write them in storage order
+static void write_level(TIFF *tiff, struct convert *conv, GThreadPool *pool,
+                        const struct level_plan *plan, int window) {
+  int64_t count = plan->across * plan->down;
+  g_autofree struct tile_job *jobs = g_new0(struct tile_job, count);
+  int64_t submitted = 0;
+  for (int64_t i = 0; i < count; i++) {
+    // keep the pool busy without holding the whole level in memory
+    for (; submitted < count && submitted < i + window; submitted++) {
+      struct tile_job *job = &jobs[submitted];
+      job->conv = conv;
+      job->plan = plan;
+      job->tx = submitted % plan->across;
+      job->ty = submitted / plan->across;
+      g_thread_pool_push(pool, job, NULL);
+    }
+
+    struct tile_job *job = &jobs[i];
+    g_mutex_lock(&conv->lock);
+    while (!job->done) {
+      g_cond_wait(&conv->cond, &conv->lock);
+    }
+    g_mutex_unlock(&conv->lock);
+
+    common_fail_on_error(conv->osr, "Reading slide");
+    if (job->err) {
+      common_fail("%s", job->err->message);
+    }
+    if (TIFFWriteRawTile(tiff, i, job->data->data, job->data->len) < 0) {
+      common_fail("Couldn't write tile %"PRId64, i);
+    }
+    g_byte_array_unref(job->data);
+  }
+}
+
+static int do_convert(int narg G_GNUC_UNUSED, char **args) {
+  const char *slide = args[0];
+  const char *outfile = args[1];
+
+  enum codec codec = CODEC_JPEG;
+  if (codec_name) {
+    bool found = false;
+    for (unsigned i = 0; i < G_N_ELEMENTS(codec_names); i++) {
+      if (g_str_equal(codec_name, codec_names[i])) {
+        codec = i;
+        found = true;
+      }
+    }
+    if (!found) {
+      common_fail("Unknown compression: %s", codec_name);
+    }
+  }
+  if (quality < 1 || quality > 100) {
+    common_fail("Quality must be between 1 and 100");
+  }
+  if (tile_size < 16 || tile_size % 16) {
+    common_fail("Tile size must be a positive multiple of 16");
+  }
+  if (threads < 0) {
+    common_fail("Thread count cannot be negative");
+  }
+  if (!threads) {
+    threads = g_get_num_processors();
+  }
+
+  g_autoptr(openslide_t) osr = openslide_open(slide);
+  common_fail_on_error(osr, "%s", slide);
+
+  struct convert conv = {
+    .osr = osr,
+    .codec = codec,
+    .background = get_background(osr),
+  };
+  g_mutex_init(&conv.lock);
+  g_cond_init(&conv.cond);
+
+  g_autoptr(GArray) plans = plan_levels(osr);
+  for (guint i = 0; i < plans->len; i++) {
+    const struct level_plan *plan =
+      &g_array_index(plans, struct level_plan, i);
+    if (plan->w > UINT32_MAX || plan->h > UINT32_MAX) {
+      common_fail("%s: Slide too large for TIFF", slide);
+    }
+  }
+
+  g_autofree char *description = make_description(osr, slide);
+  int64_t icc_size = openslide_get_icc_profile_size(osr);
+  g_autofree void *icc = NULL;
+  if (icc_size > 0) {
+    icc = g_malloc(icc_size);
+    openslide_read_icc_profile(osr, icc);
+    common_fail_on_error(osr, "Reading ICC profile");
+  }
+
+  TIFF *tiff = TIFFOpen(outfile, "w8");
+  if (!tiff) {
+    common_fail("Can't open %s for writing", outfile);
+  }
+  GThreadPool *pool = g_thread_pool_new(encode_tile, NULL, threads, true,
+                                        NULL);
+  for (guint i = 0; i < plans->len; i++) {
+    const struct level_plan *plan =
+      &g_array_index(plans, struct level_plan, i);
+    set_tags(tiff, &conv, plan, i == 0, description, icc, icc_size);
+    write_level(tiff, &conv, pool, plan, 4 * threads);
+    if (!TIFFWriteDirectory(tiff)) {
+      common_fail("Couldn't write TIFF directory for level %u", i);
+    }
+  }
+  g_thread_pool_free(pool, false, true);
+  TIFFClose(tiff);
+
+  g_mutex_clear(&conv.lock);
+  g_cond_clear(&conv.cond);
+  return 0;
+}
+
+static const GOptionEntry convert_opts[] = {
+  {"compression", 'c', 0, G_OPTION_ARG_STRING, &codec_name,
+   "Tile compression: jpeg or zstd (default: jpeg)", "CODEC"},
+  {"quality", 'q', 0, G_OPTION_ARG_INT, &quality,
+   "JPEG quality (default: 90)", "QUALITY"},
+  {"tile-size", 's', 0, G_OPTION_ARG_INT, &tile_size,
+   "Tile width and height (default: 512)", "PIXELS"},
+  {"threads", 't', 0, G_OPTION_ARG_INT, &threads,
+   "Encoder threads (default: number of CPUs)", "COUNT"},
+  {NULL, 0, 0, G_OPTION_ARG_NONE, NULL, NULL, NULL}
+};
+
+const struct command convert_cmd = {
+  .name = "convert",
+  .parameter_string = "<FILE> <OUTPUT-TIFF>",
+  .summary = "Convert a slide to a pyramidal TIFF",
+  .description = "Write a slide to a tiled, pyramidal BigTIFF that "
+    "OpenSlide can read as a generic TIFF, preserving its ICC profile and "
+    "key properties.",
+  .options = convert_opts,
+  .min_positional = 2,
+  .max_positional = 2,
+  .handler = do_convert,
+};
@@ -0,0 +1,142 @@
+/*
+ *  OpenSlide, a library for reading whole slide image files
+ *
+ *  Copyright (c) 2026 OpenSlide contributors
+ *  All rights reserved.
+ *
+ *  OpenSlide is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation, version 2.1.
+ *
+ *  OpenSlide is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with OpenSlide. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+#include <setjmp.h>
+#include <glib.h>
+#include <jpeglib.h>
+#include "openslide.h"
+#include "slidetool.h"
+
+G_DEFINE_QUARK(slidetool-error-quark, slidetool_error)
+
+#define JPEG_DEST_CHUNK 65536
+
+uint32_t get_background(openslide_t *osr) {
+  const char *bgcolor =
+    openslide_get_property_value(osr, OPENSLIDE_PROPERTY_NAME_BACKGROUND_COLOR);
+  unsigned r, g, b;
+  if (bgcolor && sscanf(bgcolor, "%2x%2x%2x", &r, &g, &b) == 3) {
+    return r << 16 | g << 8 | b;
+  }
+  return 0xffffff;
+}
+
+void argb_to_rgb(uint8_t *dst, const uint32_t *src, int64_t count,
+                 uint32_t background) {
+  const uint32_t bg[] = {
+    (background >> 16) & 0xff, (background >> 8) & 0xff, background & 0xff,
+  };
+  for (int64_t i = 0; i < count; i++) {
+    uint32_t p = src[i];
+    uint32_t a = p >> 24;
+    if (a == 255) {
+      *dst++ = p >> 16;
+      *dst++ = p >> 8;
+      *dst++ = p;
+    } else {
+      // premultiplied, so just add the background's share
+      uint32_t t = 255 - a;
+      *dst++ = ((p >> 16) & 0xff) + (bg[0] * t + 127) / 255;
+      *dst++ = ((p >> 8) & 0xff) + (bg[1] * t + 127) / 255;
+      *dst++ = (p & 0xff) + (bg[2] * t + 127) / 255;
+    }
+  }
+}
+
+struct jpeg_dest {
+  struct jpeg_destination_mgr pub;
+  GByteArray *out;
+  JOCTET chunk[JPEG_DEST_CHUNK];
+};
+
+static void jpeg_dest_init(j_compress_ptr cinfo) {
+  struct jpeg_dest *dest = (struct jpeg_dest *) cinfo->dest;
+  dest->pub.next_output_byte = dest->chunk;
+  dest->pub.free_in_buffer = JPEG_DEST_CHUNK;
+}
+
+static boolean jpeg_dest_empty(j_compress_ptr cinfo) {
+  struct jpeg_dest *dest = (struct jpeg_dest *) cinfo->dest;
+  g_byte_array_append(dest->out, dest->chunk, JPEG_DEST_CHUNK);
+  dest->pub.next_output_byte = dest->chunk;
+  dest->pub.free_in_buffer = JPEG_DEST_CHUNK;
+  return TRUE;
+}
+
+static void jpeg_dest_term(j_compress_ptr cinfo) {
+  struct jpeg_dest *dest = (struct jpeg_dest *) cinfo->dest;
+  g_byte_array_append(dest->out, dest->chunk,
+                      JPEG_DEST_CHUNK - dest->pub.free_in_buffer);
+}
+
+struct jpeg_encode_err {
+  struct jpeg_error_mgr pub;
+  jmp_buf env;
+};
+
+static void jpeg_encode_error_exit(j_common_ptr cinfo) {
+  struct jpeg_encode_err *jerr = (struct jpeg_encode_err *) cinfo->err;
+  longjmp(jerr->env, 1);
+}
+
+bool encode_jpeg(const uint8_t *rgb, int32_t w, int32_t h, int quality,
+                 GByteArray *out, GError **err) {
+  struct jpeg_compress_struct cinfo;
+  struct jpeg_encode_err jerr;
+  g_autofree struct jpeg_dest *dest = g_new0(struct jpeg_dest, 1);
+  dest->pub.init_destination = jpeg_dest_init;
+  dest->pub.empty_output_buffer = jpeg_dest_empty;
+  dest->pub.term_destination = jpeg_dest_term;
+  dest->out = out;
+
+  memset(&cinfo, 0, sizeof(cinfo));
+  cinfo.err = jpeg_std_error(&jerr.pub);
+  jerr.pub.error_exit = jpeg_encode_error_exit;
+  if (setjmp(jerr.env)) {
+    char msg[JMSG_LENGTH_MAX];
+    jerr.pub.format_message((j_common_ptr) &cinfo, msg);
+    g_set_error(err, SLIDETOOL_ERROR, 0, "Couldn't encode JPEG: %s", msg);
+    jpeg_destroy_compress(&cinfo);
+    return false;
+  }
+
+  jpeg_create_compress(&cinfo);
+  cinfo.dest = &dest->pub;
+  cinfo.image_width = w;
+  cinfo.image_height = h;
+  cinfo.input_components = 3;
+  cinfo.in_color_space = JCS_RGB;
+  jpeg_set_defaults(&cinfo);
+  jpeg_set_quality(&cinfo, quality, TRUE);
+  jpeg_start_compress(&cinfo, TRUE);
+  while (cinfo.next_scanline < cinfo.image_height) {
+    JSAMPROW rows[] = {
+      (JSAMPROW) rgb + (int64_t) cinfo.next_scanline * w * 3,
+    };
+    jpeg_write_scanlines(&cinfo, rows, 1);
+  }
+  jpeg_finish_compress(&cinfo);
+  jpeg_destroy_compress(&cinfo);
+  return true;
+}
@@ -0,0 +1,408 @@
+/*
+ *  OpenSlide, a library for reading whole slide image files
+ *
+ *  Copyright (c) 2026 OpenSlide contributors
+ *  All rights reserved.
+ *
+ *  OpenSlide is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation, version 2.1.
+ *
+ *  OpenSlide is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with OpenSlide. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <glib.h>
+#include "openslide.h"
+#include "openslide-common.h"
+#include "slidetool.h"
+
+/*
+ * Deep Zoom export.  The top level is read from slide level 0 and each
+ * lower level is box-filtered from the one above it, so the slide is read
+ * exactly once.  Levels are produced as rows of "core" tiles without
+ * overlap.  A level's output tiles are cut from its cores once the rows
+ * above and below are available, and a core row is freed as soon as
+ * neither its own level's output nor the next level down needs it.
+ */
+
+static gint tile_size = 254;
+static gint overlap = 1;
+static gint quality = 90;
+static gint threads;
+
+struct level {
+  int64_t w;
+  int64_t h;
+  int64_t across;
+  int64_t down;
+  // core tiles, indexed by row and then column; NULL if absent or freed
+  uint32_t ***rows;
+  int64_t produced;  // rows of cores
+  int64_t emitted;   // rows of output tiles
+  char *dir;
+};
+
+struct export {
+  openslide_t *osr;
+  uint32_t background;
+  struct level *levels;
+  int32_t level_count;
+
+  GThreadPool *pool;
+  GMutex lock;
+  GCond cond;
+  int pending;
+  GError *err;
+};
+
+enum job_type {
+  JOB_PRODUCE,
+  JOB_EMIT,
+};
+
+struct job {
+  struct export *ex;
+  enum job_type type;
+  int32_t level;
+  int64_t col;
+  int64_t row;
+};
+
+static void core_dims(const struct level *l, int64_t col, int64_t row,
+                      int32_t *w, int32_t *h) {
+  *w = MIN(tile_size, l->w - col * tile_size);
+  *h = MIN(tile_size, l->h - row * tile_size);
+}
+
+// average each 2x2 block of the child into the parent at (ox, oy),
+// using only the pixels that exist at the right and bottom edges
+static void downsample_into(uint32_t *parent, int32_t pw,
+                            const uint32_t *child, int32_t cw, int32_t ch,
+                            int32_t ox, int32_t oy) {
+  for (int32_t y = 0; y < (ch + 1) / 2; y++) {
+    for (int32_t x = 0; x < (cw + 1) / 2; x++) {
+      uint32_t sum[4] = {0};
+      uint32_t n = 0;
+      for (int32_t sy = 2 * y; sy < MIN(2 * y + 2, ch); sy++) {
+        for (int32_t sx = 2 * x; sx < MIN(2 * x + 2, cw); sx++) {
+          uint32_t p = child[(int64_t) sy * cw + sx];
+          sum[0] += p >> 24;
+          sum[1] += (p >> 16) & 0xff;
+          sum[2] += (p >> 8) & 0xff;
+          sum[3] += p & 0xff;
+          n++;
+        }
+      }
+      parent[(int64_t) (oy + y) * pw + ox + x] =
+        (sum[0] + n / 2) / n << 24 | (sum[1] + n / 2) / n << 16 |
+        (sum[2] + n / 2) / n << 8 | (sum[3] + n / 2) / n;
+    }
+  }
+}
+
+static void produce_core(struct export *ex, int32_t level, int64_t col,
+                         int64_t row) {
+  struct level *l = &ex->levels[level];
+  int32_t w, h;
+  core_dims(l, col, row, &w, &h);
+  uint32_t *core = g_malloc((int64_t) w * h * 4);
+
+  if (level == ex->level_count - 1) {
+    // top level comes from the slide
+    openslide_read_region(ex->osr, core, col * tile_size, row * tile_size,
+                          0, w, h);
+  } else {
+    struct level *child = &ex->levels[level + 1];
+    for (int dy = 0; dy < 2; dy++) {
+      for (int dx = 0; dx < 2; dx++) {
+        int64_t ccol = 2 * col + dx;
+        int64_t crow = 2 * row + dy;
+        if (ccol >= child->across || crow >= child->down) {
+          continue;
+        }
+        int32_t cw, ch;
+        core_dims(child, ccol, crow, &cw, &ch);
+        downsample_into(core, w, child->rows[crow][ccol], cw, ch,
+                        dx * tile_size / 2, dy * tile_size / 2);
+      }
+    }
+  }
+
+  l->rows[row][col] = core;
+}
+
+static bool emit_tile(struct export *ex, int32_t level, int64_t col,
+                      int64_t row, GError **err) {
+  struct level *l = &ex->levels[level];
+  int64_t x0 = MAX(col * tile_size - overlap, 0);
+  int64_t y0 = MAX(row * tile_size - overlap, 0);
+  int64_t x1 = MIN((col + 1) * tile_size + overlap, l->w);
+  int64_t y1 = MIN((row + 1) * tile_size + overlap, l->h);
+  int32_t w = x1 - x0;
+  int32_t h = y1 - y0;
+
+  // assemble from the neighboring cores
+  g_autofree uint32_t *argb = g_malloc((int64_t) w * h * 4);
+  for (int64_t r = MAX(row - 1, 0); r <= MIN(row + 1, l->down - 1); r++) {
+    for (int64_t c = MAX(col - 1, 0); c <= MIN(col + 1, l->across - 1); c++) {
+      int32_t cw, ch;
+      core_dims(l, c, r, &cw, &ch);
+      int64_t cx0 = MAX(c * tile_size, x0);
+      int64_t cy0 = MAX(r * tile_size, y0);
+      int64_t cx1 = MIN(c * tile_size + cw, x1);
+      int64_t cy1 = MIN(r * tile_size + ch, y1);
+      if (cx0 >= cx1 || cy0 >= cy1) {
+        continue;
+      }
+      const uint32_t *core = l->rows[r][c];
+      for (int64_t y = cy0; y < cy1; y++) {
+        memcpy(argb + (y - y0) * w + (cx0 - x0),
+               core + (y - r * tile_size) * cw + (cx0 - c * tile_size),
+               (cx1 - cx0) * 4);
+      }
+    }
+  }
+
+  g_autofree uint8_t *rgb = g_malloc((int64_t) w * h * 3);
+  argb_to_rgb(rgb, argb, (int64_t) w * h, ex->background);
+  g_autoptr(GByteArray) jpeg = g_byte_array_new();
+  if (!encode_jpeg(rgb, w, h, quality, jpeg, err)) {
+    return false;
+  }
+  g_autofree char *path =
+    g_strdup_printf("%s/%"PRId64"_%"PRId64".jpeg", l->dir, col, row);
+  return g_file_set_contents(path, (char *) jpeg->data, jpeg->len, err);
+}
+
+static void run_job(void *data, void *user_data G_GNUC_UNUSED) {
+  struct job *job = data;
+  struct export *ex = job->ex;
+  GError *tmp_err = NULL;
+  switch (job->type) {
+  case JOB_PRODUCE:
+    produce_core(ex, job->level, job->col, job->row);
+    break;
+  case JOB_EMIT:
+    emit_tile(ex, job->level, job->col, job->row, &tmp_err);
+    break;
+  }
+  g_free(job);
+
+  g_mutex_lock(&ex->lock);
+  if (tmp_err && !ex->err) {
+    ex->err = g_steal_pointer(&tmp_err);
+  }
+  ex->pending--;
+  g_cond_broadcast(&ex->cond);
+  g_mutex_unlock(&ex->lock);
+  g_clear_error(&tmp_err);
+}
+
+// run one job per column of the row, and wait for them
+static void run_row(struct export *ex, enum job_type type, int32_t level,
+                    int64_t row) {
+  struct level *l = &ex->levels[level];
+  g_mutex_lock(&ex->lock);
+  ex->pending += l->across;
+  g_mutex_unlock(&ex->lock);
+  for (int64_t col = 0; col < l->across; col++) {
+    struct job *job = g_new(struct job, 1);
+    *job = (struct job) {
+      .ex = ex,
+      .type = type,
+      .level = level,
+      .col = col,
+      .row = row,
+    };
+    g_thread_pool_push(ex->pool, job, NULL);
+  }
+  g_mutex_lock(&ex->lock);
+  while (ex->pending) {
+    g_cond_wait(&ex->cond, &ex->lock);
+  }
+  g_mutex_unlock(&ex->lock);
+
+  common_fail_on_error(ex->osr, "Reading slide");
+  if (ex->err) {
+    common_fail("%s", ex->err->message);
+  }
+}
+
+static void free_row(struct level *l, int64_t row) {
+  if (!l->rows[row]) {
+    return;
+  }
+  for (int64_t col = 0; col < l->across; col++) {
+    g_free(l->rows[row][col]);
+  }
+  g_clear_pointer(&l->rows[row], g_free);
+}
+
+// do whatever work is ready, from the top level down
+static bool advance(struct export *ex) {
+  bool progress = false;
+  for (int32_t i = ex->level_count - 1; i >= 0; i--) {
+    struct level *l = &ex->levels[i];
+    struct level *child = i < ex->level_count - 1 ? &ex->levels[i + 1] : NULL;
+
+    // produce a core row once its child rows exist
+    if (l->produced < l->down &&
+        (!child ||
+         child->produced >= MIN(2 * l->produced + 2, child->down))) {
+      l->rows[l->produced] = g_new0(uint32_t *, l->across);
+      run_row(ex, JOB_PRODUCE, i, l->produced);
+      l->produced++;
+      progress = true;
+    }
+
+    // emit an output row once the core row below it exists
+    if (l->emitted < l->produced &&
+        (l->emitted + 1 < l->produced || l->produced == l->down)) {
+      run_row(ex, JOB_EMIT, i, l->emitted);
+      l->emitted++;
+      progress = true;
+    }
+
+    // free core rows that no one needs
+    if (child) {
+      for (int64_t row = 0; row < child->produced; row++) {
+        if (row + 1 < child->emitted && row < 2 * l->produced) {
+          free_row(child, row);
+        }
+      }
+    }
+  }
+  return progress;
+}
+
+static int do_export_dzi(int narg G_GNUC_UNUSED, char **args) {
+  const char *slide = args[0];
+  const char *base = args[1];
+
+  if (tile_size < 2 || tile_size % 2) {
+    common_fail("Tile size must be a positive even number");
+  }
+  if (overlap < 0 || overlap > tile_size / 2) {
+    common_fail("Overlap must be between 0 and half the tile size");
+  }
+  if (quality < 1 || quality > 100) {
+    common_fail("Quality must be between 1 and 100");
+  }
+  if (threads < 0) {
+    common_fail("Thread count cannot be negative");
+  }
+  if (!threads) {
+    threads = g_get_num_processors();
+  }
+
+  g_autoptr(openslide_t) osr = openslide_open(slide);
+  common_fail_on_error(osr, "%s", slide);
+  int64_t w, h;
+  openslide_get_level0_dimensions(osr, &w, &h);
+
+  // level 0 is 1x1; the top level is full size
+  int32_t level_count = 1;
+  while (MAX(w, h) > ((int64_t) 1 << (level_count - 1))) {
+    level_count++;
+  }
+
+  struct export ex = {
+    .osr = osr,
+    .background = get_background(osr),
+    .levels = g_new0(struct level, level_count),
+    .level_count = level_count,
+  };
+  g_mutex_init(&ex.lock);
+  g_cond_init(&ex.cond);
+
+  g_autofree char *files_dir = g_strdup_printf("%s_files", base);
+  for (int32_t i = level_count - 1; i >= 0; i--) {
+    struct level *l = &ex.levels[i];
+    int shift = level_count - 1 - i;
+    l->w = MAX((w + ((int64_t) 1 << shift) - 1) >> shift, 1);
+    l->h = MAX((h + ((int64_t) 1 << shift) - 1) >> shift, 1);
+    l->across = (l->w + tile_size - 1) / tile_size;
+    l->down = (l->h + tile_size - 1) / tile_size;
+    l->rows = g_new0(uint32_t **, l->down);
+    l->dir = g_strdup_printf("%s/%d", files_dir, i);
+    if (g_mkdir_with_parents(l->dir, 0777)) {
+      common_fail("Can't create %s: %s", l->dir, g_strerror(errno));
+    }
+  }
+
+  ex.pool = g_thread_pool_new(run_job, NULL, threads, true, NULL);
+  while (advance(&ex)) {
+  }
+  g_thread_pool_free(ex.pool, false, true);
+
+  // descriptor last, so its presence means the export is complete
+  g_autofree char *dzi_path = g_strdup_printf("%s.dzi", base);
+  g_autofree char *dzi = g_strdup_printf(
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+    "<Image xmlns=\"http://schemas.microsoft.com/deepzoom/2008\" "
+    "Format=\"jpeg\" Overlap=\"%d\" TileSize=\"%d\">"
+    "<Size Height=\"%"PRId64"\" Width=\"%"PRId64"\"/></Image>\n",
+    overlap, tile_size, h, w);
+  g_autoptr(GError) tmp_err = NULL;
+  if (!g_file_set_contents(dzi_path, dzi, -1, &tmp_err)) {
+    common_fail("%s", tmp_err->message);
+  }
+
+  for (int32_t i = 0; i < level_count; i++) {
+    struct level *l = &ex.levels[i];
+    for (int64_t row = 0; row < l->down; row++) {
+      free_row(l, row);
+    }
+    g_free(l->rows);
+    g_free(l->dir);
+  }
+  g_free(ex.levels);
+  g_mutex_clear(&ex.lock);
+  g_cond_clear(&ex.cond);
+  return 0;
+}
+
+static const GOptionEntry dzi_opts[] = {
+  {"tile-size", 's', 0, G_OPTION_ARG_INT, &tile_size,
+   "Tile width and height, excluding overlap (default: 254)", "PIXELS"},
+  {"overlap", 'o', 0, G_OPTION_ARG_INT, &overlap,
+   "Pixels of overlap on each interior tile edge (default: 1)", "PIXELS"},
+  {"quality", 'q', 0, G_OPTION_ARG_INT, &quality,
+   "JPEG quality (default: 90)", "QUALITY"},
+  {"threads", 't', 0, G_OPTION_ARG_INT, &threads,
+   "Worker threads (default: number of CPUs)", "COUNT"},
+  {NULL, 0, 0, G_OPTION_ARG_NONE, NULL, NULL, NULL}
+};
+
+static const struct command export_subcmds[] = {
+  {
+    .name = "dzi",
+    .parameter_string = "<FILE> <OUTPUT-BASE>",
+    .summary = "Export a Deep Zoom tile pyramid",
+    .description = "Write a Deep Zoom descriptor to OUTPUT-BASE.dzi and "
+      "its JPEG tiles to OUTPUT-BASE_files.",
+    .options = dzi_opts,
+    .min_positional = 2,
+    .max_positional = 2,
+    .handler = do_export_dzi,
+  },
+  {}
+};
+
+const struct command export_cmd = {
+  .name = "export",
+  .summary = "Commands for exporting slides to other formats",
+  .subcommands = export_subcmds,
+};
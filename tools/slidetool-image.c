@@ -25,6 +25,7 @@
 #include "slidetool.h"
 
 #include <png.h>
+#include <zlib.h>
 #include <inttypes.h>
 #include <glib.h>
 #include <stdio.h>
@@ -36,6 +37,12 @@ static const char SOFTWARE[] = "Software";
 static const char OPENSLIDE[] = "OpenSlide <https://openslide.org/>";
 static const char ICC_PROFILE[] = "ICC";
 static const uint32_t BUFSIZE = 16 << 20;
+// uncompressed bytes per parallel deflate job
+static const uint32_t DEFLATE_CHUNK = 1 << 20;
+// widest row for which a job's output fits in one IDAT chunk
+static const int32_t MAX_PARALLEL_WIDTH = 128 << 20;
+
+static gint threads = 1;
 
 #define ENSURE_NONNEG(i) \
   if (i < 0) {                               \
@@ -81,10 +88,9 @@ static void setup_png(png_structp png_ptr, png_infop info_ptr,
   png_set_text(png_ptr, info_ptr, text_ptr, 1);
 }
 
-static void write_lines_png(png_structp png_ptr, uint32_t *buf,
-                            int32_t w, int32_t h) {
-  // un-premultiply alpha and pack into expected format, modifying buf
-  for (int32_t i = 0; i < w * h; i++) {
+// un-premultiply alpha and pack into expected format, modifying buf
+static void unpremultiply(uint32_t *buf, int64_t count) {
+  for (int64_t i = 0; i < count; i++) {
     uint32_t p = buf[i];
 
     uint8_t a = p >> 24;
@@ -105,10 +111,196 @@ static void write_lines_png(png_structp png_ptr, uint32_t *buf,
       buf[i] = GUINT32_TO_BE(r << 24 | g << 16 | b << 8 | a);
     }
   }
+}
 
+static void write_lines_png(png_structp png_ptr, uint32_t *buf,
+                            int32_t w, int32_t h) {
   for (int32_t i = 0; i < h; i++) {
-    png_write_row(png_ptr, (png_bytep) &buf[w * i]);
+    png_write_row(png_ptr, (png_bytep) &buf[(int64_t) w * i]);
+  }
+}
+
+static uint8_t paeth(uint8_t a, uint8_t b, uint8_t c) {
+  int p = a + b - c;
+  int pa = abs(p - a);
+  int pb = abs(p - b);
+  int pc = abs(p - c);
+  if (pa <= pb && pa <= pc) {
+    return a;
+  } else if (pb <= pc) {
+    return b;
+  }
+  return c;
+}
+
+// apply PNG filter type to an RGBA row; return the heuristic cost
+static uint64_t filter_row(uint8_t *out, int type, const uint8_t *row,
+                           const uint8_t *prev, int64_t len) {
+  uint64_t cost = 0;
+  for (int64_t i = 0; i < len; i++) {
+    uint8_t a = i >= 4 ? row[i - 4] : 0;
+    uint8_t b = prev[i];
+    uint8_t c = i >= 4 ? prev[i - 4] : 0;
+    uint8_t v;
+    switch (type) {
+    case PNG_FILTER_VALUE_SUB:
+      v = row[i] - a;
+      break;
+    case PNG_FILTER_VALUE_UP:
+      v = row[i] - b;
+      break;
+    case PNG_FILTER_VALUE_AVG:
+      v = row[i] - (a + b) / 2;
+      break;
+    case PNG_FILTER_VALUE_PAETH:
+      v = row[i] - paeth(a, b, c);
+      break;
+    default:
+      v = row[i];
+      break;
+    }
+    out[i] = v;
+    cost += abs((int8_t) v);
+  }
+  return cost;
+}
+
+// a run of rows deflated independently of the rest of the image
+struct deflate_job {
+  struct deflater *d;
+  const uint8_t *rows;
+  const uint8_t *prev;  // row above the first row
+  int32_t w;
+  int32_t count;
+  bool last;
+
+  uint8_t *out;
+  size_t out_len;
+  uint32_t adler;
+  size_t in_len;
+};
+
+struct deflater {
+  GThreadPool *pool;
+  GMutex lock;
+  GCond cond;
+  int pending;
+  bool failed;
+};
+
+static bool deflate_rows(struct deflate_job *job) {
+  int64_t row_len = (int64_t) job->w * 4;
+  job->in_len = (row_len + 1) * job->count;
+  g_autofree uint8_t *filtered = g_malloc(job->in_len);
+  g_autofree uint8_t *scratch = g_malloc(row_len);
+
+  // choose each row's filter by minimum sum of absolute differences,
+  // as libpng does
+  const uint8_t *prev = job->prev;
+  for (int32_t y = 0; y < job->count; y++) {
+    const uint8_t *row = job->rows + y * row_len;
+    uint8_t *out = filtered + y * (row_len + 1);
+    out[0] = PNG_FILTER_VALUE_NONE;
+    uint64_t best = filter_row(out + 1, PNG_FILTER_VALUE_NONE, row, prev,
+                               row_len);
+    for (int type = PNG_FILTER_VALUE_SUB; type <= PNG_FILTER_VALUE_PAETH;
+         type++) {
+      uint64_t cost = filter_row(scratch, type, row, prev, row_len);
+      if (cost < best) {
+        best = cost;
+        out[0] = type;
+        memcpy(out + 1, scratch, row_len);
+      }
+    }
+    prev = row;
+  }
+  job->adler = adler32(adler32(0, NULL, 0), filtered, job->in_len);
+
+  // raw deflate; a sync flush byte-aligns the end so the streams of
+  // consecutive jobs can be concatenated
+  z_stream strm = {0};
+  if (deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8,
+                   Z_FILTERED) != Z_OK) {
+    return false;
+  }
+  size_t bound = deflateBound(&strm, job->in_len) + 16;
+  job->out = g_malloc(bound);
+  strm.next_in = filtered;
+  strm.avail_in = job->in_len;
+  strm.next_out = job->out;
+  strm.avail_out = bound;
+  int ret = deflate(&strm, job->last ? Z_FINISH : Z_SYNC_FLUSH);
+  job->out_len = bound - strm.avail_out;
+  deflateEnd(&strm);
+  return ret == (job->last ? Z_STREAM_END : Z_OK) && !strm.avail_in;
+}
+
+static void run_deflate_job(void *data, void *user_data G_GNUC_UNUSED) {
+  struct deflate_job *job = data;
+  struct deflater *d = job->d;
+  bool ok = deflate_rows(job);
+  g_mutex_lock(&d->lock);
+  if (!ok) {
+    d->failed = true;
+  }
+  d->pending--;
+  g_cond_broadcast(&d->cond);
+  g_mutex_unlock(&d->lock);
+}
+
+// the pieces of a zlib stream are written as consecutive IDAT chunks
+static void write_idat(png_structp png_ptr, const uint8_t *head,
+                       size_t head_len, const uint8_t *data, size_t len,
+                       const uint8_t *tail, size_t tail_len) {
+  png_write_chunk_start(png_ptr, (png_const_bytep) "IDAT",
+                        head_len + len + tail_len);
+  png_write_chunk_data(png_ptr, head, head_len);
+  png_write_chunk_data(png_ptr, data, len);
+  png_write_chunk_data(png_ptr, tail, tail_len);
+  png_write_chunk_end(png_ptr);
+}
+
+struct band {
+  uint32_t *buf;
+  int32_t lines;
+};
+
+// prefetches bands on a separate thread while the previous one is
+// being compressed
+struct reader {
+  openslide_t *osr;
+  int64_t x;
+  int64_t y;
+  int32_t level;
+  int32_t w;
+  int32_t h;
+  int32_t lines_at_a_time;
+  GAsyncQueue *free_bands;
+  GAsyncQueue *full_bands;
+};
+
+static bool put_band(const uint32_t *buf, int64_t row G_GNUC_UNUSED,
+                     int64_t h, void *data) {
+  struct reader *r = data;
+  struct band *band = g_async_queue_pop(r->free_bands);
+  band->lines = h;
+  memcpy(band->buf, buf, (int64_t) r->w * h * 4);
+  unpremultiply(band->buf, (int64_t) r->w * h);
+  g_async_queue_push(r->full_bands, band);
+  return true;
+}
+
+static void *read_bands(void *data) {
+  struct reader *r = data;
+  openslide_read_region_stream(r->osr, r->x, r->y, r->level, r->w, r->h,
+                               r->lines_at_a_time, put_band, r);
+  if (openslide_get_error(r->osr)) {
+    // wake the writer, which will report the error
+    struct band *band = g_async_queue_pop(r->free_bands);
+    band->lines = 0;
+    g_async_queue_push(r->full_bands, band);
   }
+  return NULL;
 }
 
 static void write_png(openslide_t *osr, FILE *f,
@@ -154,26 +346,116 @@ static void write_png(openslide_t *osr, FILE *f,
   // start writing
   png_write_info(png_ptr, info_ptr);
 
-  const int32_t lines_at_a_time = MAX(BUFSIZE / (w * 4), 1);
-  g_autofree uint32_t *dest = g_malloc(lines_at_a_time * w * 4);
+  // double-buffered
+  struct reader r = {
+    .osr = osr,
+    .x = x,
+    .y = y,
+    .level = level,
+    .w = w,
+    .h = h,
+    .lines_at_a_time = MAX(BUFSIZE / ((int64_t) w * 4), 1),
+    .free_bands = g_async_queue_new(),
+    .full_bands = g_async_queue_new(),
+  };
+  struct band bands[2];
+  for (unsigned i = 0; i < G_N_ELEMENTS(bands); i++) {
+    bands[i].buf = g_malloc((int64_t) r.lines_at_a_time * w * 4);
+    g_async_queue_push(r.free_bands, &bands[i]);
+  }
+  GThread *reader = g_thread_new("read-region", read_bands, &r);
+
+  // compress with libpng, or with parallel deflate into our own IDATs
+  bool parallel = threads > 1 && w <= MAX_PARALLEL_WIDTH;
+  struct deflater d = {0};
+  g_autofree uint8_t *prev_row = NULL;
+  g_autofree struct deflate_job *jobs = NULL;
+  const int32_t rows_per_job = MAX(DEFLATE_CHUNK / ((int64_t) w * 4), 1);
+  if (parallel) {
+    g_mutex_init(&d.lock);
+    g_cond_init(&d.cond);
+    d.pool = g_thread_pool_new(run_deflate_job, NULL, threads, true, NULL);
+    prev_row = g_malloc0((int64_t) w * 4);
+    jobs = g_new(struct deflate_job,
+                 (r.lines_at_a_time + rows_per_job - 1) / rows_per_job);
+  }
+  const uint8_t zlib_header[] = {0x78, 0x9c};
+  uint32_t adler = adler32(0, NULL, 0);
+
   int32_t lines_to_draw = h;
-  double ds = openslide_get_level_downsample(osr, level);
-  int32_t yy = y / ds;
   while (lines_to_draw) {
-    const int32_t lines = MIN(lines_at_a_time, lines_to_draw);
-    openslide_read_region(osr, dest,
-                          x, yy * ds, level, w, lines);
-
+    struct band *band = g_async_queue_pop(r.full_bands);
     common_fail_on_error(osr, "Reading region");
+    lines_to_draw -= band->lines;
+
+    if (!parallel) {
+      write_lines_png(png_ptr, band->buf, w, band->lines);
+      g_async_queue_push(r.free_bands, band);
+      continue;
+    }
 
-    write_lines_png(png_ptr, dest, w, lines);
+    const uint8_t *rows = (const uint8_t *) band->buf;
+    int64_t row_len = (int64_t) w * 4;
+    int njobs = 0;
+    for (int32_t i = 0; i < band->lines; i += rows_per_job) {
+      struct deflate_job *job = &jobs[njobs++];
+      *job = (struct deflate_job) {
+        .d = &d,
+        .rows = rows + i * row_len,
+        .prev = i ? rows + (i - 1) * row_len : prev_row,
+        .w = w,
+        .count = MIN(rows_per_job, band->lines - i),
+      };
+      job->last = !lines_to_draw && i + job->count == band->lines;
+    }
+    g_mutex_lock(&d.lock);
+    d.pending = njobs;
+    g_mutex_unlock(&d.lock);
+    for (int i = 0; i < njobs; i++) {
+      g_thread_pool_push(d.pool, &jobs[i], NULL);
+    }
+    g_mutex_lock(&d.lock);
+    while (d.pending) {
+      g_cond_wait(&d.cond, &d.lock);
+    }
+    g_mutex_unlock(&d.lock);
+    if (d.failed) {
+      common_fail("Error compressing PNG");
+    }
 
-    yy += lines;
-    lines_to_draw -= lines;
+    for (int i = 0; i < njobs; i++) {
+      struct deflate_job *job = &jobs[i];
+      bool first = lines_to_draw + band->lines == h && !i;
+      adler = adler32_combine(adler, job->adler, job->in_len);
+      uint8_t trailer[4];
+      for (int j = 0; j < 4; j++) {
+        trailer[j] = adler >> (24 - 8 * j);
+      }
+      write_idat(png_ptr, zlib_header, first ? sizeof(zlib_header) : 0,
+                 job->out, job->out_len, trailer, job->last ? 4 : 0);
+      g_free(job->out);
+    }
+    memcpy(prev_row, rows + (band->lines - 1) * row_len, row_len);
+    g_async_queue_push(r.free_bands, band);
+  }
+
+  g_thread_join(reader);
+  for (unsigned i = 0; i < G_N_ELEMENTS(bands); i++) {
+    g_free(bands[i].buf);
   }
+  g_async_queue_unref(r.free_bands);
+  g_async_queue_unref(r.full_bands);
 
   // end
-  png_write_end(png_ptr, info_ptr);
+  if (parallel) {
+    g_thread_pool_free(d.pool, false, true);
+    g_mutex_clear(&d.lock);
+    g_cond_clear(&d.cond);
+    // png_write_end() requires IDATs written by libpng
+    png_write_chunk(png_ptr, (png_const_bytep) "IEND", NULL, 0);
+  } else {
+    png_write_end(png_ptr, info_ptr);
+  }
   png_destroy_write_struct(&png_ptr, &info_ptr);
 }
 
@@ -194,6 +476,7 @@ static int write_region_png(const char *slide, int64_t x, int64_t y,
   }
   ENSURE_POS(width);
   ENSURE_POS(height);
+  ENSURE_POS(threads);
   if (width > INT32_MAX) {
     common_fail("width must be <= %d for PNG", INT32_MAX);
   }
@@ -305,6 +588,7 @@ static void assoc_read(openslide_t *osr, const char *image, FILE *f,
   openslide_read_associated_image(osr, image, dest);
   common_fail_on_error(osr, "Reading associated image");
 
+  unpremultiply(dest, (int64_t) w * h);
   write_lines_png(png_ptr, dest, w, h);
 
   // end
@@ -345,6 +629,12 @@ const struct command write_png_cmd = {
   .handler = do_write_png,
 };
 
+static const GOptionEntry region_read_opts[] = {
+  {"threads", 't', 0, G_OPTION_ARG_INT, &threads,
+   "Compression threads (default: 1)", "COUNT"},
+  {NULL, 0, 0, G_OPTION_ARG_NONE, NULL, NULL, NULL}
+};
+
 static const struct command region_subcmds[] = {
   {
     .command = &region_icc_cmd,
@@ -354,6 +644,7 @@ static const struct command region_subcmds[] = {
     .parameter_string = "<SLIDE> <X> <Y> <LEVEL> <WIDTH> <HEIGHT> [OUTPUT-PNG]",
     .summary = "Write a virtual slide region to a PNG",
     .description = "Write a region of a virtual slide to a PNG.",
+    .options = region_read_opts,
     .min_positional = 6,
     .max_positional = 7,
     .handler = do_region_read,
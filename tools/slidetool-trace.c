@@ -0,0 +1,430 @@
+/*
+ *  OpenSlide, a library for reading whole slide image files
+ *
+ *  Copyright (c) 2026 OpenSlide contributors
+ *  All rights reserved.
+ *
+ *  OpenSlide is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation, version 2.1.
+ *
+ *  OpenSlide is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with OpenSlide. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <glib.h>
+#include "openslide.h"
+#include "openslide-common.h"
+#include "slidetool.h"
+
+// replays traces written with OPENSLIDE_TRACE; see src/openslide-trace.c
+
+enum call {
+  CALL_OPEN,
+  CALL_READ_REGION,
+  CALL_READ_REGION_STREAM,
+  CALL_READ_ASSOCIATED_IMAGE,
+  CALL_CLOSE,
+  NUM_CALLS,
+};
+
+static const char *const call_names[NUM_CALLS] = {
+  [CALL_OPEN] = "open",
+  [CALL_READ_REGION] = "read_region",
+  [CALL_READ_REGION_STREAM] = "read_region_stream",
+  [CALL_READ_ASSOCIATED_IMAGE] = "read_associated_image",
+  [CALL_CLOSE] = "close",
+};
+
+struct event {
+  int64_t start;
+  int64_t duration;
+  uint64_t seq;
+  uint32_t thread;
+  uint32_t handle;
+  enum call call;
+  char *str;  // filename or associated image name
+  int64_t x;
+  int64_t y;
+  int32_t level;
+  int64_t w;
+  int64_t h;
+  int64_t band_h;
+};
+
+struct handle {
+  openslide_t *osr;
+  gint refcount;
+  gint failed;
+};
+
+struct replay {
+  GMutex lock;
+  GArray *latencies[NUM_CALLS];
+  int64_t errors;
+  int64_t skipped;
+};
+
+struct job {
+  struct replay *replay;
+  struct handle *handle;
+  const struct event *event;
+};
+
+static double speed = 1;
+static gint threads;
+static gint64 cache_size = -1;
+
+static void event_clear(struct event *ev) {
+  g_free(ev->str);
+}
+
+static int cmp_event(const void *a, const void *b) {
+  const struct event *x = a;
+  const struct event *y = b;
+  if (x->start != y->start) {
+    return (x->start > y->start) - (x->start < y->start);
+  }
+  return (x->seq > y->seq) - (x->seq < y->seq);
+}
+
+static bool parse_int64(const char *str, int64_t *result) {
+  char *endptr;
+  gint64 value = g_ascii_strtoll(str, &endptr, 10);
+  if (!*str || *endptr) {
+    return false;
+  }
+  *result = value;
+  return true;
+}
+
+static bool parse_event(char *line, uint64_t seq, struct event *ev) {
+  g_auto(GStrv) fields = g_strsplit(line, "\t", 0);
+  guint count = g_strv_length(fields);
+  if (count < 6) {
+    return false;
+  }
+  int64_t thread, handle, level;
+  if (!parse_int64(fields[0], &ev->start) ||
+      !parse_int64(fields[1], &thread) ||
+      !parse_int64(fields[2], &ev->duration) ||
+      !parse_int64(fields[3], &handle)) {
+    return false;
+  }
+  ev->seq = seq;
+  ev->thread = thread;
+  ev->handle = handle;
+
+  int call;
+  for (call = 0; call < NUM_CALLS; call++) {
+    if (g_str_equal(fields[4], call_names[call])) {
+      break;
+    }
+  }
+  ev->call = call;
+  switch (ev->call) {
+  case CALL_OPEN:
+  case CALL_READ_ASSOCIATED_IMAGE:
+    if (count != 7) {
+      return false;
+    }
+    ev->str = g_strcompress(fields[6]);
+    return true;
+  case CALL_READ_REGION:
+    if (count != 11 ||
+        !parse_int64(fields[6], &ev->x) ||
+        !parse_int64(fields[7], &ev->y) ||
+        !parse_int64(fields[8], &level) ||
+        !parse_int64(fields[9], &ev->w) ||
+        !parse_int64(fields[10], &ev->h) ||
+        ev->w < 0 || ev->h < 0) {
+      return false;
+    }
+    ev->level = level;
+    return true;
+  case CALL_READ_REGION_STREAM:
+    if (count != 12 ||
+        !parse_int64(fields[6], &ev->x) ||
+        !parse_int64(fields[7], &ev->y) ||
+        !parse_int64(fields[8], &level) ||
+        !parse_int64(fields[9], &ev->w) ||
+        !parse_int64(fields[10], &ev->h) ||
+        !parse_int64(fields[11], &ev->band_h) ||
+        ev->w < 0 || ev->h < 0) {
+      return false;
+    }
+    ev->level = level;
+    return true;
+  case CALL_CLOSE:
+    return count == 6;
+  default:
+    return false;
+  }
+}
+
+static GArray *read_trace(const char *filename) {
+  g_autofree char *contents = NULL;
+  GError *err = NULL;
+  if (!g_file_get_contents(filename, &contents, NULL, &err)) {
+    common_fail("%s", err->message);
+  }
+
+  g_autoptr(GArray) events = g_array_new(false, false, sizeof(struct event));
+  g_array_set_clear_func(events, (GDestroyNotify) event_clear);
+  g_auto(GStrv) lines = g_strsplit(contents, "\n", 0);
+  for (uint64_t i = 0; lines[i]; i++) {
+    if (!lines[i][0] || lines[i][0] == '#') {
+      continue;
+    }
+    struct event ev = {0};
+    if (!parse_event(lines[i], i, &ev)) {
+      common_fail("%s:%"PRIu64": Couldn't parse trace record", filename,
+                  i + 1);
+    }
+    g_array_append_val(events, ev);
+  }
+
+  // records are written when calls finish
+  g_array_sort(events, cmp_event);
+  return g_steal_pointer(&events);
+}
+
+static void handle_unref(struct handle *handle) {
+  if (g_atomic_int_dec_and_test(&handle->refcount)) {
+    if (handle->osr) {
+      openslide_close(handle->osr);
+    }
+    g_free(handle);
+  }
+}
+
+static void record(struct replay *replay, enum call call, int64_t start,
+                   bool failed) {
+  int64_t elapsed = g_get_monotonic_time() - start;
+  g_mutex_lock(&replay->lock);
+  g_array_append_val(replay->latencies[call], elapsed);
+  if (failed) {
+    replay->errors++;
+  }
+  g_mutex_unlock(&replay->lock);
+}
+
+static void record_skip(struct replay *replay) {
+  g_mutex_lock(&replay->lock);
+  replay->skipped++;
+  g_mutex_unlock(&replay->lock);
+}
+
+static bool discard_band(const uint32_t *buf G_GNUC_UNUSED,
+                         int64_t row G_GNUC_UNUSED,
+                         int64_t h G_GNUC_UNUSED,
+                         void *data G_GNUC_UNUSED) {
+  return true;
+}
+
+static void run_job(void *data, void *user_data G_GNUC_UNUSED) {
+  struct job *job = data;
+  const struct event *ev = job->event;
+  openslide_t *osr = job->handle->osr;
+
+  if (openslide_get_error(osr)) {
+    // errors are sticky, so the handle can't do anything more
+    record_skip(job->replay);
+    handle_unref(job->handle);
+    g_free(job);
+    return;
+  }
+
+  int64_t start = g_get_monotonic_time();
+  if (ev->call == CALL_READ_REGION) {
+    g_autofree uint32_t *buf = g_malloc(ev->w * ev->h * 4);
+    start = g_get_monotonic_time();
+    openslide_read_region(osr, buf, ev->x, ev->y, ev->level, ev->w, ev->h);
+  } else if (ev->call == CALL_READ_REGION_STREAM) {
+    openslide_read_region_stream(osr, ev->x, ev->y, ev->level, ev->w, ev->h,
+                                 ev->band_h, discard_band, NULL);
+  } else {
+    int64_t w, h;
+    openslide_get_associated_image_dimensions(osr, ev->str, &w, &h);
+    if (w != -1) {
+      g_autofree uint32_t *buf = g_malloc(w * h * 4);
+      start = g_get_monotonic_time();
+      openslide_read_associated_image(osr, ev->str, buf);
+    }
+  }
+  // count only the call that put the handle into error state
+  bool failed = openslide_get_error(osr) != NULL &&
+                g_atomic_int_compare_and_exchange(&job->handle->failed, 0, 1);
+  record(job->replay, ev->call, start, failed);
+
+  handle_unref(job->handle);
+  g_free(job);
+}
+
+static int count_threads(GArray *events) {
+  g_autoptr(GHashTable) seen = g_hash_table_new(g_direct_hash, g_direct_equal);
+  for (guint i = 0; i < events->len; i++) {
+    struct event *ev = &g_array_index(events, struct event, i);
+    g_hash_table_add(seen, GUINT_TO_POINTER(ev->thread));
+  }
+  return MAX(g_hash_table_size(seen), 1);
+}
+
+static int do_trace_replay(int narg G_GNUC_UNUSED, char **args) {
+  if (speed < 0) {
+    common_fail("Speed cannot be negative");
+  }
+  if (threads < 0) {
+    common_fail("Thread count cannot be negative");
+  }
+
+  g_autoptr(GArray) events = read_trace(args[0]);
+  if (!events->len) {
+    common_fail("%s: Trace is empty", args[0]);
+  }
+  int nthreads = threads ? threads : count_threads(events);
+
+  openslide_cache_t *cache = NULL;
+  if (cache_size >= 0) {
+    cache = openslide_cache_create(cache_size);
+  }
+
+  struct replay replay = {0};
+  g_mutex_init(&replay.lock);
+  GArray *recorded[NUM_CALLS];
+  for (int i = 0; i < NUM_CALLS; i++) {
+    replay.latencies[i] = g_array_new(false, false, sizeof(int64_t));
+    recorded[i] = g_array_new(false, false, sizeof(int64_t));
+  }
+
+  // trace handle -> struct handle
+  g_autoptr(GHashTable) handles =
+    g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+                          (GDestroyNotify) handle_unref);
+  GThreadPool *pool = g_thread_pool_new(run_job, NULL, nthreads, true, NULL);
+
+  const struct event *first = &g_array_index(events, struct event, 0);
+  int64_t replay_start = g_get_monotonic_time();
+  for (guint i = 0; i < events->len; i++) {
+    const struct event *ev = &g_array_index(events, struct event, i);
+    g_array_append_val(recorded[ev->call], ev->duration);
+
+    // wait for the scheduled time
+    if (speed > 0) {
+      int64_t due = replay_start + (ev->start - first->start) / speed;
+      int64_t now = g_get_monotonic_time();
+      if (due > now) {
+        g_usleep(due - now);
+      }
+    }
+
+    // opens and closes run here, so later reads find their handle
+    if (ev->call == CALL_OPEN) {
+      int64_t start = g_get_monotonic_time();
+      openslide_t *osr = openslide_open(ev->str);
+      record(&replay, CALL_OPEN, start,
+             osr == NULL || openslide_get_error(osr) != NULL);
+      if (osr && cache) {
+        openslide_set_cache(osr, cache);
+      }
+      struct handle *handle = g_new0(struct handle, 1);
+      handle->osr = osr;
+      handle->refcount = 1;
+      if (ev->handle) {
+        g_hash_table_replace(handles, GUINT_TO_POINTER(ev->handle), handle);
+      } else {
+        handle_unref(handle);
+      }
+      continue;
+    }
+    struct handle *handle =
+      g_hash_table_lookup(handles, GUINT_TO_POINTER(ev->handle));
+    if (!handle || !handle->osr) {
+      // the open wasn't traced, or failed during replay
+      record_skip(&replay);
+      continue;
+    }
+    if (ev->call == CALL_CLOSE) {
+      // closes when outstanding reads finish
+      int64_t start = g_get_monotonic_time();
+      g_hash_table_remove(handles, GUINT_TO_POINTER(ev->handle));
+      record(&replay, CALL_CLOSE, start, false);
+      continue;
+    }
+
+    struct job *job = g_new0(struct job, 1);
+    job->replay = &replay;
+    job->handle = handle;
+    job->event = ev;
+    g_atomic_int_inc(&handle->refcount);
+    g_thread_pool_push(pool, job, NULL);
+  }
+  g_thread_pool_free(pool, false, true);
+  double elapsed = (g_get_monotonic_time() - replay_start) / 1e6;
+  g_hash_table_remove_all(handles);
+  if (cache) {
+    openslide_cache_release(cache);
+  }
+
+  printf("Replayed %u calls in %.3f s at speed %g with %d threads, "
+         "%"PRId64" errors, %"PRId64" skipped\n\n",
+         events->len, elapsed, speed, nthreads, replay.errors,
+         replay.skipped);
+  print_latency_header("recorded");
+  for (int i = 0; i < NUM_CALLS; i++) {
+    print_latencies(call_names[i], recorded[i]);
+    g_array_unref(recorded[i]);
+  }
+  printf("\n");
+  print_latency_header("replayed");
+  for (int i = 0; i < NUM_CALLS; i++) {
+    print_latencies(call_names[i], replay.latencies[i]);
+    g_array_unref(replay.latencies[i]);
+  }
+  g_mutex_clear(&replay.lock);
+
+  return replay.errors != 0;
+}
+
+static const GOptionEntry trace_replay_opts[] = {
+  {"speed", 's', 0, G_OPTION_ARG_DOUBLE, &speed,
+   "Playback speed relative to the trace, or 0 for no delays (default: 1)",
+   "FACTOR"},
+  {"threads", 't', 0, G_OPTION_ARG_INT, &threads,
+   "Worker threads (default: number of threads in the trace)", "COUNT"},
+  {"cache-size", 'c', 0, G_OPTION_ARG_INT64, &cache_size,
+   "Shared tile cache size in bytes (default: per-slide default cache)",
+   "BYTES"},
+  {NULL, 0, 0, G_OPTION_ARG_NONE, NULL, NULL, NULL}
+};
+
+static const struct command trace_subcmds[] = {
+  {
+    .name = "replay",
+    .parameter_string = "<TRACE-FILE>",
+    .summary = "Replay an access trace",
+    .description = "Replay a trace recorded with OPENSLIDE_TRACE=<file> "
+      "and report call latencies.",
+    .options = trace_replay_opts,
+    .min_positional = 1,
+    .max_positional = 1,
+    .handler = do_trace_replay,
+  },
+  {}
+};
+
+const struct command trace_cmd = {
+  .name = "trace",
+  .summary = "Commands related to access traces",
+  .subcommands = trace_subcmds,
+};
@@ -20,8 +20,10 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <errno.h>
+#include <inttypes.h>
 #include "openslide-common.h"
 #include "slidetool.h"
 
@@ -53,3 +55,38 @@ void _close_output(struct output *out) {
     }
   }
 }
+
+static int cmp_int64(const void *a, const void *b) {
+  int64_t x = *(const int64_t *) a;
+  int64_t y = *(const int64_t *) b;
+  return (x > y) - (x < y);
+}
+
+// nearest-rank percentile of a sorted array
+static int64_t percentile(const int64_t *sorted, guint count, int pct) {
+  guint rank = ((uint64_t) count * pct + 99) / 100;
+  return sorted[MAX(rank, 1) - 1];
+}
+
+void print_latency_header(const char *label) {
+  printf("%-24s %8s %9s %9s %9s %9s %9s\n", label, "count",
+         "mean ms", "p50 ms", "p95 ms", "p99 ms", "max ms");
+}
+
+void print_latencies(const char *label, GArray *samples) {
+  if (!samples->len) {
+    return;
+  }
+  int64_t *us = (int64_t *) samples->data;
+  qsort(us, samples->len, sizeof(int64_t), cmp_int64);
+  double total = 0;
+  for (guint i = 0; i < samples->len; i++) {
+    total += us[i];
+  }
+  printf("%-24s %8u %9.3f %9.3f %9.3f %9.3f %9.3f\n", label, samples->len,
+         total / samples->len / 1000,
+         percentile(us, samples->len, 50) / 1000.0,
+         percentile(us, samples->len, 95) / 1000.0,
+         percentile(us, samples->len, 99) / 1000.0,
+         us[samples->len - 1] / 1000.0);
+}
@@ -52,6 +52,15 @@ static const struct command root_subcmds[] = {
   {
     .command = &assoc_cmd,
   },
+  {
+    .command = &bench_cmd,
+  },
+  {
+    .command = &convert_cmd,
+  },
+  {
+    .command = &export_cmd,
+  },
   {
     .command = &prop_cmd,
   },
@@ -61,6 +70,9 @@ static const struct command root_subcmds[] = {
   {
     .command = &slide_cmd,
   },
+  {
+    .command = &trace_cmd,
+  },
   {}
 };
 
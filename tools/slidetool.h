@@ -23,7 +23,10 @@
 #define OPENSLIDE_SLIDETOOL_H_
 
 #include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <glib.h>
+#include "openslide.h"
 
 struct command {
   // subcommand name
@@ -47,10 +50,14 @@ extern const GOptionEntry legacy_opts[];
 
 extern const struct command assoc_cmd;
 extern const struct command assoc_icc_cmd;
+extern const struct command bench_cmd;
+extern const struct command convert_cmd;
+extern const struct command export_cmd;
 extern const struct command prop_cmd;
 extern const struct command region_cmd;
 extern const struct command region_icc_cmd;
 extern const struct command slide_cmd;
+extern const struct command trace_cmd;
 
 extern const struct command quickhash1sum_cmd;
 extern const struct command show_properties_cmd;
@@ -64,4 +71,21 @@ struct output open_output(const char *filename);
 void _close_output(struct output *out);
 G_DEFINE_AUTO_CLEANUP_CLEAR_FUNC(output, _close_output);
 
+// latency samples are GArrays of int64_t microseconds
+void print_latency_header(const char *label);
+// sorts the samples
+void print_latencies(const char *label, GArray *samples);
+
+// errors from worker threads, reported by the main thread
+#define SLIDETOOL_ERROR slidetool_error_quark()
+GQuark slidetool_error_quark(void);
+
+// background color as 0xRRGGBB, white if the slide doesn't specify one
+uint32_t get_background(openslide_t *osr);
+// composite premultiplied ARGB onto the background
+void argb_to_rgb(uint8_t *dst, const uint32_t *src, int64_t count,
+                 uint32_t background);
+bool encode_jpeg(const uint8_t *rgb, int32_t w, int32_t h, int quality,
+                 GByteArray *out, GError **err);
+
 #endif